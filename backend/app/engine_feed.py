@@ -0,0 +1,104 @@
+"""Reader for the C++ engine's shared-memory feed (cpp/qs_feed.h).
+
+The engine publishes with `mini_test --shm NAME`; records are read through
+libqsfeed.so (built from cpp/qs_feed.cpp) and turned into the same message
+dicts the WebSocket clients already receive.
+"""
+import ctypes
+import os
+from typing import Optional
+
+QS_TICK, QS_BAR, QS_SIGNAL, QS_POSITION, QS_FILL = 1, 2, 3, 4, 5
+
+# Bit order of reason:: in mini_test.cpp
+REASON_NAMES = ["RSI_oversold", "RSI_overbought", "EMA_cross_up", "EMA_cross_down",
+                "above_VWAP", "below_VWAP", "VOL_spike", "UPTREND", "DOWNTREND",
+                "HTF_up", "HTF_down"]
+# ExitReason values in mini_test.cpp
+EXIT_NAMES = ["NONE", "STOP_LOSS", "TRAILING_STOP", "TAKE_PROFIT", "MAX_HOLD", "EOD_FLATTEN"]
+
+DEFAULT_LIB = os.path.join(os.path.dirname(__file__), "..", "..", "cpp", "libqsfeed.so")
+
+
+class FeedRecord(ctypes.Structure):
+    _fields_ = [
+        ("seq", ctypes.c_uint64),
+        ("time", ctypes.c_int64),
+        ("bar", ctypes.c_int32),
+        ("type", ctypes.c_uint8),
+        ("side", ctypes.c_int8),
+        ("code", ctypes.c_uint16),
+        ("px", ctypes.c_double * 5),
+    ]
+
+
+assert ctypes.sizeof(FeedRecord) == 64
+
+
+class EngineFeed:
+    """Polls /dev/shm/NAME; open() returns False until the engine has created it."""
+
+    def __init__(self, name: str, lib_path: Optional[str] = None, batch: int = 1024):
+        self.name = name
+        self.lib = ctypes.CDLL(lib_path or os.getenv("QS_FEED_LIB", DEFAULT_LIB))
+        self.lib.qs_feed_open.restype = ctypes.c_void_p
+        self.lib.qs_feed_open.argtypes = [ctypes.c_char_p]
+        self.lib.qs_feed_close.argtypes = [ctypes.c_void_p]
+        self.lib.qs_feed_read.restype = ctypes.c_int
+        self.lib.qs_feed_read.argtypes = [ctypes.c_void_p, ctypes.POINTER(FeedRecord), ctypes.c_int]
+        self.lib.qs_feed_head.restype = ctypes.c_uint64
+        self.lib.qs_feed_head.argtypes = [ctypes.c_void_p]
+        self.lib.qs_feed_dropped.restype = ctypes.c_uint64
+        self.lib.qs_feed_dropped.argtypes = [ctypes.c_void_p]
+        self.lib.qs_feed_symbol.restype = ctypes.c_char_p
+        self.lib.qs_feed_symbol.argtypes = [ctypes.c_void_p]
+        self.handle = None
+        self.symbol = ""
+        self.buf = (FeedRecord * batch)()
+
+    def open(self) -> bool:
+        if self.handle is None:
+            self.handle = self.lib.qs_feed_open(self.name.encode())
+            if self.handle:
+                self.symbol = self.lib.qs_feed_symbol(self.handle).decode()
+        return bool(self.handle)
+
+    def close(self):
+        if self.handle:
+            self.lib.qs_feed_close(self.handle)
+        self.handle = None
+
+    @property
+    def dropped(self) -> int:
+        return self.lib.qs_feed_dropped(self.handle) if self.handle else 0
+
+    def poll(self) -> list[dict]:
+        """New records since the last call, as WebSocket messages."""
+        if not self.open():
+            return []
+        n = self.lib.qs_feed_read(self.handle, self.buf, len(self.buf))
+        return [self._message(self.buf[i]) for i in range(n)]
+
+    def _message(self, r: FeedRecord) -> dict:
+        sym, t, px = self.symbol, r.time / 1e9, r.px
+        if r.type == QS_TICK:
+            return {"type": "tick", "symbol": sym, "price": px[0], "size": px[1], "time": t}
+        if r.type == QS_BAR:
+            return {"type": "bar", "symbol": sym, "tf": "5s", "bar": r.bar, "t": t,
+                    "o": px[0], "h": px[1], "l": px[2], "c": px[3], "v": px[4]}
+        if r.type == QS_SIGNAL:
+            return {"type": "signal", "symbol": sym, "bar": r.bar, "time": t,
+                    "action": "BUY" if r.side > 0 else "SELL", "score": px[0],
+                    "reasons": [n for b, n in enumerate(REASON_NAMES) if r.code >> b & 1]}
+        if r.type == QS_POSITION:
+            side = {1: "LONG", -1: "SHORT"}.get(r.side, "FLAT")
+            return {"type": "position", "symbol": sym, "side": side, "qty": int(px[3]),
+                    "avg_price": px[0], "stop": px[1], "target": px[2], "source": "engine"}
+        if r.type == QS_FILL:
+            msg = {"type": "fill", "symbol": sym, "side": "BUY" if r.side > 0 else "SELL",
+                   "price": px[0], "qty": int(px[1]), "bar": r.bar, "source": "engine"}
+            if r.code:
+                msg["pnl"] = round(px[2], 2)
+                msg["reason"] = EXIT_NAMES[r.code] if r.code < len(EXIT_NAMES) else str(r.code)
+            return msg
+        return {"type": "unknown", "record_type": r.type}
@@ -16,10 +16,12 @@ from sqlalchemy import select, desc
 from sqlalchemy.ext.asyncio import AsyncSession
 
 from .models import init_db, get_db, async_session, Trade, Order, BotConfig
+from .engine_feed import EngineFeed
 
 load_dotenv(os.path.join(os.path.dirname(__file__), "..", ".env"))
 
 DEMO_MODE = os.getenv("DEMO_MODE", "true").lower() == "true"
+ENGINE_FEED = os.getenv("ENGINE_FEED", "")  # shm name published by `mini_test --shm NAME`
 
 
 # ─── Market Simulator (Demo Mode) ──────────────────────────
@@ -216,6 +218,8 @@ market = DemoMarket()
 account = DemoAccount()
 ws_manager = ConnectionManager()
 _market_task = None
+_engine_task = None
+engine_feed: Optional[EngineFeed] = None
 
 
 async def market_loop():
@@ -251,18 +255,37 @@ async def market_loop():
             await ws_manager.broadcast(market.get_dom(sym))
 
 
+async def engine_loop():
+    """Background task: relay the C++ engine's shared-memory feed via WebSocket."""
+    while True:
+        msgs = engine_feed.poll()
+        for msg in msgs:
+            if msg["type"] == "position":
+                msg["unrealized_pnl"] = 0.0
+            await ws_manager.broadcast(msg)
+        # Busy engine: yield briefly; idle or not started yet: back off
+        await asyncio.sleep(0.001 if msgs else 0.01)
+
+
 @asynccontextmanager
 async def lifespan(app: FastAPI):
-    global _market_task
+    global _market_task, _engine_task, engine_feed
     try:
         await init_db()
     except Exception:
         pass  # DB might not be running yet, demo mode works without it
     if DEMO_MODE:
         _market_task = asyncio.create_task(market_loop())
+    if ENGINE_FEED:
+        engine_feed = EngineFeed(ENGINE_FEED)
+        _engine_task = asyncio.create_task(engine_loop())
     yield
     if _market_task:
         _market_task.cancel()
+    if _engine_task:
+        _engine_task.cancel()
+    if engine_feed:
+        engine_feed.close()
 
 
 # ─── FastAPI App ──────────────────────────
@@ -423,6 +446,10 @@ async def get_bars(symbol: str, tf: str = "5s", count: int = 500):
 
 @app.get("/api/bot/status")
 async def bot_status():
+    if engine_feed and engine_feed.open():
+        return {"running": True, "signals": [], "stats": {},
+                "feed": {"name": ENGINE_FEED, "symbol": engine_feed.symbol,
+                         "dropped": engine_feed.dropped}}
     return {"running": False, "signals": [], "stats": {}}
 
 
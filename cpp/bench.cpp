@@ -0,0 +1,348 @@
+// ============================================================================
+// QuadScalp Bench — micro-benchmarks for the per-bar hot path
+// Times indicators, scoring, simulation, order matching, journaling, exit checks and JSON export in ns/op
+// Build: g++ -O3 -std=c++20 -pthread -o bench bench.cpp
+// Run:   ./bench [--cpu N] [--reps N] [--warmup N] [--filter NAME]
+//                [--json FILE] [--compare FILE] [--tolerance PCT]
+// ============================================================================
+#define QUADSCALP_NO_MAIN
+#include "mini_test.cpp"
+
+#include <sstream>
+
+// ── Engine Probe (friend of TradingEngine) ──────────────────────────────────
+struct EngineProbe {
+    // Open long with stops far enough that check_exit runs its full path
+    static void hold_long(TradingEngine& e, Ticks entry) {
+        e.pos_side_ = Side::LONG;
+        e.entry_price_ = entry;
+        e.entry_bar_ = 1 << 30;   // never reaches MAX_HOLD
+        e.stop_price_ = 0;
+        e.target_price_ = 1 << 30;
+        e.max_favorable_ = 0;
+    }
+    static ExitReason check_exit(TradingEngine& e, const Bar& bar) { return e.check_exit(bar); }
+
+    // Chart history + trades as a console run of `bars` would leave them
+    static void fill(TradingEngine& e, const std::vector<Bar>& bars) {
+        e.backtest(bars.data(), bars.size());
+        e.quiet_ = false;
+        SignalEngine sig;
+        e.bar_history_.reserve(bars.size());
+        for (const Bar& b : bars) {
+            sig.evaluate(b);
+            e.bar_history_.push_back({b.index, b.close, sig.rsi(), sig.ema9(), sig.ema21(),
+                sig.vwap_val(), sig.atr_val()});
+        }
+    }
+};
+
+// ── Harness ─────────────────────────────────────────────────────────────────
+namespace bench {
+
+template <class T>
+inline void keep(const T& v) { asm volatile("" : : "r,m"(v) : "memory"); }
+
+struct Result {
+    std::string name;
+    size_t ops = 0;
+    int    reps = 0;
+    double median = 0, mean = 0, stddev = 0, min = 0, max = 0;
+    double cv() const { return mean > 0 ? 100.0 * stddev / mean : 0; }
+};
+
+struct Options {
+    int    cpu = 0;            // -1: no pinning
+    int    reps = 15;
+    int    warmup = 3;
+    const char* filter = nullptr;
+    const char* json = nullptr;
+    const char* compare = nullptr;
+    double tolerance = 5.0;    // % median regression allowed by --compare
+};
+
+// Runs body() warmup + reps times; body performs `ops` operations per call
+template <class F>
+inline Result measure(const char* name, size_t ops, const Options& opt, F&& body) {
+    for (int i = 0; i < opt.warmup; ++i) body();
+
+    std::vector<double> ns(opt.reps);
+    for (int r = 0; r < opt.reps; ++r) {
+        auto t0 = std::chrono::steady_clock::now();
+        body();
+        auto t1 = std::chrono::steady_clock::now();
+        ns[r] = std::chrono::duration<double, std::nano>(t1 - t0).count() / (double)ops;
+    }
+
+    Result res;
+    res.name = name;
+    res.ops = ops;
+    res.reps = opt.reps;
+    std::sort(ns.begin(), ns.end());
+    size_t n = ns.size();
+    res.median = n % 2 ? ns[n / 2] : 0.5 * (ns[n / 2 - 1] + ns[n / 2]);
+    res.min = ns.front();
+    res.max = ns.back();
+    res.mean = std::accumulate(ns.begin(), ns.end(), 0.0) / (double)n;
+    double var = 0;
+    for (double x : ns) var += (x - res.mean) * (x - res.mean);
+    res.stddev = n > 1 ? std::sqrt(var / (double)(n - 1)) : 0;
+    return res;
+}
+
+// One result per line so --compare can read it back without a JSON parser
+inline bool write_json(const char* path, const std::vector<Result>& results, int cpu) {
+    std::FILE* f = std::fopen(path, "w");
+    if (!f) return false;
+    std::fprintf(f, "{\"cpu\":%d,\"results\":[\n", cpu);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::fprintf(f, "{\"name\":\"%s\",\"ops\":%zu,\"reps\":%d,\"median_ns\":%.4f,\"mean_ns\":%.4f,"
+            "\"stddev_ns\":%.4f,\"min_ns\":%.4f,\"max_ns\":%.4f,\"cv_pct\":%.2f}%s\n",
+            r.name.c_str(), r.ops, r.reps, r.median, r.mean, r.stddev, r.min, r.max, r.cv(),
+            i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(f, "]}\n");
+    return std::fclose(f) == 0;
+}
+
+// name -> median_ns from a previous --json file
+inline std::vector<std::pair<std::string, double>> read_medians(const char* path) {
+    std::vector<std::pair<std::string, double>> out;
+    std::ifstream f(path);
+    for (std::string line; std::getline(f, line);) {
+        size_t n = line.find("\"name\":\"");
+        size_t m = line.find("\"median_ns\":");
+        if (n == std::string::npos || m == std::string::npos) continue;
+        n += 8;
+        size_t e = line.find('"', n);
+        if (e == std::string::npos) continue;
+        out.emplace_back(line.substr(n, e - n), std::strtod(line.c_str() + m + 12, nullptr));
+    }
+    return out;
+}
+
+} // namespace bench
+
+// ── Benchmarks ──────────────────────────────────────────────────────────────
+int main(int argc, char* argv[]) {
+    bench::Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--cpu" && i + 1 < argc) opt.cpu = std::stoi(argv[++i]);
+        if (arg == "--reps" && i + 1 < argc) opt.reps = std::max(1, std::stoi(argv[++i]));
+        if (arg == "--warmup" && i + 1 < argc) opt.warmup = std::max(0, std::stoi(argv[++i]));
+        if (arg == "--filter" && i + 1 < argc) opt.filter = argv[++i];
+        if (arg == "--json" && i + 1 < argc) opt.json = argv[++i];
+        if (arg == "--compare" && i + 1 < argc) opt.compare = argv[++i];
+        if (arg == "--tolerance" && i + 1 < argc) opt.tolerance = std::stod(argv[++i]);
+    }
+
+    bool pinned = pin_thread(opt.cpu);
+    if (opt.cpu >= 0 && !pinned)
+        std::fprintf(stderr, "warning: could not pin to CPU %d (%s)\n", opt.cpu, std::strerror(errno));
+
+    // Inputs: one simulated session, cycled for the per-update benchmarks
+    constexpr size_t N = 1 << 16;
+    constexpr size_t MASK = N - 1;
+    constexpr size_t OPS = 1 << 20;
+    constexpr int EXPORT_BARS = 20000;
+    std::vector<Bar> bars = simulate_bars((int)N - 1);
+
+    std::vector<bench::Result> results;
+    auto run = [&](const char* name, size_t ops, auto&& body) {
+        if (opt.filter && !std::strstr(name, opt.filter)) return;
+        results.push_back(bench::measure(name, ops, opt, body));
+    };
+
+    RSI rsi(14);
+    run("rsi_update", OPS, [&] {
+        for (size_t i = 0; i < OPS; ++i) rsi.update(bars[i & MASK].close);
+        bench::keep(rsi.value());
+    });
+
+    EMA ema(9);
+    run("ema_update", OPS, [&] {
+        for (size_t i = 0; i < OPS; ++i) ema.update(bars[i & MASK].close);
+        bench::keep(ema.value());
+    });
+
+    VWAP vwap;
+    run("vwap_update", OPS, [&] {
+        for (size_t i = 0; i < OPS; ++i) vwap.update(bars[i & MASK].vwap, bars[i & MASK].volume);
+        bench::keep(vwap.value());
+    });
+
+    ATR atr(14);
+    run("atr_update", OPS, [&] {
+        for (size_t i = 0; i < OPS; ++i) {
+            const Bar& b = bars[i & MASK];
+            atr.update(b.high, b.low, b.close);
+        }
+        bench::keep(atr.value());
+    });
+
+    RollingStats<> stats(20);
+    run("rolling_stats_update", OPS, [&] {
+        for (size_t i = 0; i < OPS; ++i) stats.update(bars[i & MASK].volume);
+        bench::keep(stats.stddev());
+    });
+
+    Donchian<> donchian(20);
+    run("donchian_update", OPS, [&] {
+        for (size_t i = 0; i < OPS; ++i) donchian.update(bars[i & MASK].high, bars[i & MASK].low);
+        bench::keep(donchian.value());
+    });
+
+    // Window length should not show up in the per-update cost
+    RollingQuantile<> median20(20), median500(500);
+    run("rolling_median20_update", OPS, [&] {
+        for (size_t i = 0; i < OPS; ++i) median20.update(bars[i & MASK].close);
+        bench::keep(median20.value());
+    });
+    run("rolling_median500_update", OPS, [&] {
+        for (size_t i = 0; i < OPS; ++i) median500.update(bars[i & MASK].close);
+        bench::keep(median500.value());
+    });
+
+    SignalEngine signal;
+    run("signal_evaluate", OPS, [&] {
+        for (size_t i = 0; i < OPS; ++i) {
+            Signal s = signal.evaluate(bars[i & MASK]);
+            bench::keep(s.score);
+        }
+    });
+
+    BasicSignalEngine<ProductionStrategy> fixed_signal;
+    run("signal_evaluate_fixed", OPS, [&] {
+        for (size_t i = 0; i < OPS; ++i) {
+            Signal s = fixed_signal.evaluate(bars[i & MASK]);
+            bench::keep(s.score);
+        }
+    });
+
+    // Per N(0,1) sample: the simulator's old serial draw vs one Philox call per 32
+    std::mt19937 mt(42);
+    std::normal_distribution<> normal(0.0, 1.0);
+    run("mt19937_normal", OPS, [&] {
+        double sum = 0;
+        for (size_t i = 0; i < OPS; ++i) sum += normal(mt);
+        bench::keep(sum);
+    });
+
+    run("philox_gaussian", OPS, [&] {
+        double z[philox::WORDS], sum = 0;
+        for (size_t i = 0; i < OPS / philox::WORDS; ++i) {
+            MarketSimulator::noise(42, (int)i, z);
+            for (double v : z) sum += v;
+        }
+        bench::keep(sum);
+    });
+
+    MarketSimulator market;
+    int next_idx = 1;
+    run("market_next_bar", N, [&] {
+        for (size_t i = 0; i < N; ++i) {
+            Bar b = market.next_bar(next_idx++);
+            bench::keep(b.close);
+        }
+    });
+
+    TradingEngine exit_engine;
+    EngineProbe::hold_long(exit_engine, bars[0].close);
+    run("check_exit", OPS, [&] {
+        for (size_t i = 0; i < OPS; ++i) {
+            ExitReason r = EngineProbe::check_exit(exit_engine, bars[i & MASK]);
+            bench::keep(r);
+        }
+    });
+
+    // Per trade print: ~2000 limits and stops working around a random-walk
+    // tape, each fill replaced by a new order so the book stays populated
+    std::vector<Ticks> tape(N);
+    std::mt19937 tape_rng(7);
+    Ticks last = 0;
+    for (auto& t : tape) t = last += (Ticks)(tape_rng() % 5) - 2;
+    OrderManager om;
+    uint32_t om_seed = 1;
+    auto place = [&](Ticks around) {
+        om_seed = om_seed * 1664525u + 1013904223u;
+        auto book = (OrderManager::Book)(om_seed >> 30);
+        int off = 1 + (int)(om_seed >> 8 & 63);
+        bool below = book == OrderManager::BUY_LIMIT || book == OrderManager::SELL_STOP;
+        om.submit(book, below ? around - off : around + off, 1 + (int)(om_seed >> 4 & 3));
+    };
+    for (int k = 0; k < 2000; ++k) place(0);
+    size_t tape_pos = 0;
+    run("order_manager_trade", OPS, [&] {
+        for (size_t i = 0; i < OPS; ++i) {
+            Ticks px = tape[tape_pos++ & MASK];
+            om.on_trade(px, 3, [&](const Fill& f) { if (f.done) place(px); });
+        }
+        bench::keep(om.fills() + om.working());
+    });
+
+    // Per journaled trade print, 1 MiB blocks written to /dev/null
+    journal::Writer jw;
+    journal::Header jh{};
+    if (!jw.open("/dev/null", jh, StrategyParams{})) std::fprintf(stderr, "journal: %s\n", jw.error().c_str());
+    run("journal_event", OPS, [&] {
+        for (size_t i = 0; i < OPS; ++i)
+            jw.event({MarketEvent::TICK, (int)(i >> 6), (int64_t)i, tape[i & MASK], 1.0});
+        bench::keep(jw.records());
+    });
+
+    // Per bar of chart history: one full results.json for EXPORT_BARS bars
+    TradingEngine export_engine;
+    EngineProbe::fill(export_engine, std::vector<Bar>(bars.begin(), bars.begin() + EXPORT_BARS));
+    std::ostringstream json;
+    run("export_json_per_bar", EXPORT_BARS, [&] {
+        json.seekp(0);
+        export_engine.write_json(json);
+        bench::keep(json.tellp());
+    });
+
+    // Report
+    std::printf("\n  %sQuadScalp Bench%s  cpu: %s  reps: %d  warmup: %d\n\n", clr::BOLD, clr::RESET,
+        pinned ? std::to_string(opt.cpu).c_str() : "unpinned", opt.reps, opt.warmup);
+    std::printf("  %s%-22s %10s %10s %10s %10s %8s%s\n", clr::CYAN,
+        "benchmark", "median ns", "min ns", "max ns", "stddev", "cv %", clr::RESET);
+    for (const auto& r : results)
+        std::printf("  %-22s %10.2f %10.2f %10.2f %10.3f %8.2f\n",
+            r.name.c_str(), r.median, r.min, r.max, r.stddev, r.cv());
+    std::printf("\n");
+
+    if (opt.json) {
+        if (!bench::write_json(opt.json, results, pinned ? opt.cpu : -1)) {
+            std::fprintf(stderr, "error: cannot write %s\n", opt.json);
+            return 1;
+        }
+        std::printf("  %sJSON exported:%s %s\n\n", clr::CYAN, clr::RESET, opt.json);
+    }
+
+    // Regression gate against a previous run: non-zero exit on a slower median
+    if (opt.compare) {
+        auto base = bench::read_medians(opt.compare);
+        if (base.empty()) {
+            std::fprintf(stderr, "error: no results in %s\n", opt.compare);
+            return 1;
+        }
+        int regressions = 0;
+        std::printf("  %s%-22s %10s %10s %8s%s\n", clr::CYAN, "vs baseline", "base ns", "now ns", "delta %", clr::RESET);
+        for (const auto& r : results) {
+            auto it = std::find_if(base.begin(), base.end(), [&](const auto& b) { return b.first == r.name; });
+            if (it == base.end() || it->second <= 0) continue;
+            double delta = 100.0 * (r.median - it->second) / it->second;
+            bool bad = delta > opt.tolerance;
+            regressions += bad;
+            std::printf("  %-22s %10.2f %10.2f %s%+8.1f%s\n", r.name.c_str(), it->second, r.median,
+                bad ? clr::RED : delta < -opt.tolerance ? clr::GREEN : "", delta, clr::RESET);
+        }
+        std::printf("\n");
+        if (regressions) {
+            std::printf("  %s%d regression(s) above %.1f%%%s\n\n", clr::RED, regressions, opt.tolerance, clr::RESET);
+            return 1;
+        }
+    }
+    return 0;
+}
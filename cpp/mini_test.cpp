@@ -1,88 +1,315 @@
 // ============================================================================
 // QuadScalp Mini Test — C++ Scalping Prototype (Zero Dependencies)
 // Simulated ES Futures | RSI + EMA + VWAP + ATR | Multi-Signal Scoring
-// Build: g++ -O3 -std=c++20 -o mini_test mini_test.cpp
+// Build: g++ -O3 -std=c++20 -pthread -o mini_test mini_test.cpp
+// Run:   ./mini_test [--bars N] [--slow] [--ticks | --book] [--stream FILE.ndjson] [--headless]
+//                    [--shm NAME]                  (publish to /dev/shm/NAME, see qs_feed.h)
+//                    [--orders [--slippage T] [--queue N]]   (working-order fills, implies --ticks)
+//        ./mini_test [...] --mc PATHS [--block K] [--threads N]   (trade resampling)
+//                    [--config FILE]               (key = value, reloaded live)
+//                    [--snapshot FILE [--snapshot-every N]] [--restore FILE]   (warm restart)
+//                    [--journal FILE]              (binary event journal, see --verify)
+//                    [--pipeline [--cpus F,S,E]]   (feed / strategy / execution threads, pinned)
+//        ./mini_test --verify FILE.qsj             (replay a journal, check decisions match)
+//        ./mini_test --sweep [--grid key=v1,v2,..|key=lo:hi:step]... [--threads N]
+//                    [--top N] [--rank net|pf|dd|expectancy]
+//        ./mini_test --seeds N [--seed S] [--vol v1,v2,..] [--mean-rev r1,r2,..] [--threads N]
+//        ./mini_test --portfolio [--instruments ES,NQ,MES,MNQ] [--threads N] [--max-loss $]
+//        ./mini_test --alloc-check [--bars N]         (zero-allocation bar/tick loop check)
+//        ./mini_test --bank LANES [--float] [--bars N]   (SoA indicator bank check)
+//        ./mini_test --record FILE [--bars N]         (write simulated bars to a store)
+//        ./mini_test --data FILE [--from SEC] [--to SEC] [--sweep ...]   (mmap replay)
+//        ./mini_test --import IN.csv OUT.qsb [--symbol ES] [--tick 0.25] [--interval SEC]
+//                    [--delim C] [--threads N]             (vendor CSV -> bar store)
+// SIMD:  add -march=native -ffp-contract=off for the AVX2/AVX-512 bank and RNG kernels
+// Latency: per-stage TSC histograms are on by default; -DQUADSCALP_LATENCY=0 removes them
 // ============================================================================
 #include <cstdio>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <iterator>
+#include <cerrno>
+#include <type_traits>
+#include <bit>
+#include <charconv>
+#include <atomic>
 #include <random>
+#include <array>
 #include <vector>
 #include <algorithm>
 #include <numeric>
 #include <chrono>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <string>
 #include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <sched.h>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "qs_feed.h"
 
 // ── Types ───────────────────────────────────────────────────────────────────
+// Prices are whole ticks of the instrument's tick size: exact to compare and
+// subtract, no re-snapping. Points (tick * tick_size) and dollars (ticks *
+// tick_value) appear only at the output edge. Derived values (VWAP, EMAs,
+// ATR) stay double, in tick units.
+using Ticks = int32_t;
+
 struct Bar {
-    int    index;
-    double open, high, low, close;
-    double volume;
-    double vwap;
+    int     index;
+    Ticks   open, high, low, close;
+    double  volume;
+    double  vwap;        // ticks
+    int64_t time;        // bar open, ns (epoch for recorded data, session-relative for simulated)
 };
 
 enum class Side { NONE, LONG, SHORT };
 enum class TradeAction { NONE, BUY, SELL };
 
+// Signal reasons: bitmask, bit order = evaluation order in SignalEngine
+namespace reason {
+    enum : uint32_t {
+        RSI_OVERSOLD   = 1u << 0,
+        RSI_OVERBOUGHT = 1u << 1,
+        EMA_CROSS_UP   = 1u << 2,
+        EMA_CROSS_DOWN = 1u << 3,
+        ABOVE_VWAP     = 1u << 4,
+        BELOW_VWAP     = 1u << 5,
+        VOL_SPIKE      = 1u << 6,
+        UPTREND        = 1u << 7,
+        DOWNTREND      = 1u << 8,
+        HTF_UP         = 1u << 9,
+        HTF_DOWN       = 1u << 10,
+    };
+    constexpr const char* NAMES[] = {
+        "RSI_oversold", "RSI_overbought", "EMA_cross_up", "EMA_cross_down",
+        "above_VWAP", "below_VWAP", "VOL_spike", "UPTREND", "DOWNTREND",
+        "HTF_up", "HTF_down",
+    };
+
+    // Renders "NAME NAME " into buf (output edge only)
+    inline const char* format(uint32_t mask, char* buf, size_t n) {
+        size_t len = 0;
+        buf[0] = '\0';
+        for (size_t b = 0; b < std::size(NAMES); ++b) {
+            if (!(mask & (1u << b))) continue;
+            int w = std::snprintf(buf + len, n - len, "%s ", NAMES[b]);
+            if (w < 0 || (size_t)w >= n - len) break;
+            len += (size_t)w;
+        }
+        return buf;
+    }
+}
+
+enum class ExitReason : uint8_t { NONE, STOP_LOSS, TRAILING_STOP, TAKE_PROFIT, MAX_HOLD, EOD_FLATTEN };
+
+inline const char* exit_reason_name(ExitReason r) {
+    switch (r) {
+    case ExitReason::STOP_LOSS:     return "STOP_LOSS";
+    case ExitReason::TRAILING_STOP: return "TRAILING_STOP";
+    case ExitReason::TAKE_PROFIT:   return "TAKE_PROFIT";
+    case ExitReason::MAX_HOLD:      return "MAX_HOLD";
+    case ExitReason::EOD_FLATTEN:   return "EOD_FLATTEN";
+    case ExitReason::NONE:          break;
+    }
+    return "NONE";
+}
+
 struct Signal {
     TradeAction action;
     double      score;       // -1.0 to +1.0
-    std::string reasons;
+    uint32_t    reasons;     // reason:: bits
+};
+
+// Tick-driven mode: a bar is BAR_OPEN, its TICKs, then BAR_CLOSE
+struct MarketEvent {
+    enum Type : uint8_t { BAR_OPEN, TICK, BAR_CLOSE };
+    Type    type;
+    int     bar;         // index of the bar being built
+    int64_t time;        // ns
+    Ticks   price;
+    double  size;
 };
 
 struct Trade {
     int    entry_bar;
     int    exit_bar;
     Side   side;
-    double entry_price;
-    double exit_price;
-    double pnl;
-    std::string exit_reason;
+    Ticks  entry_price;
+    Ticks  exit_price;
+    double pnl;          // $ after commission
+    ExitReason exit_reason;
+};
+
+// ── Strategy Parameters (defaults = production config) ─────────────────────
+struct StrategyParams {
+    // Indicator periods
+    int    rsi_period   = 14;
+    int    ema_fast     = 9;
+    int    ema_slow     = 21;
+    int    ema_trend    = 50;
+    int    atr_period   = 14;
+    // Scoring weights
+    double w_rsi        = 0.20;
+    double w_ema        = 0.25;
+    double w_vwap       = 0.15;
+    double w_mom        = 0.15;
+    double w_vol        = 0.10;
+    double w_trend      = 0.15;
+    double min_score    = 0.50;
+    double w_mtf        = 0.0;   // 1m/5m/15m trend agreement (0 = off)
+    double min_atr      = 2.0;   // anti-chop: no entries while ATR < this many ticks
+    // Exits
+    double stop_atr     = 1.5;   // stop distance in ATRs
+    double target_atr   = 3.0;   // target distance in ATRs
+    double trailing_pct = 0.5;   // share of max favorable excursion kept
+    // Risk limits (RiskManager)
+    double max_daily_loss = -500;
+    double max_trade_loss = -150;
+    int    max_trades     = 50;
+};
+
+// Named field setter for --grid axes and --config files; false on an unknown
+// key or a period / trade count below 1
+inline bool set_param(StrategyParams& p, const std::string& key, double v) {
+    bool count = key == "rsi" || key == "ema_fast" || key == "ema_slow" || key == "ema_trend"
+              || key == "atr" || key == "max_trades";
+    if (count && !(v >= 1 && v <= INT32_MAX)) return false;
+    if      (key == "rsi")       p.rsi_period   = (int)v;
+    else if (key == "ema_fast")  p.ema_fast     = (int)v;
+    else if (key == "ema_slow")  p.ema_slow     = (int)v;
+    else if (key == "ema_trend") p.ema_trend    = (int)v;
+    else if (key == "atr")       p.atr_period   = (int)v;
+    else if (key == "w_rsi")     p.w_rsi        = v;
+    else if (key == "w_ema")     p.w_ema        = v;
+    else if (key == "w_vwap")    p.w_vwap       = v;
+    else if (key == "w_mom")     p.w_mom        = v;
+    else if (key == "w_vol")     p.w_vol        = v;
+    else if (key == "w_trend")   p.w_trend      = v;
+    else if (key == "min_score") p.min_score    = v;
+    else if (key == "mtf")       p.w_mtf        = v;
+    else if (key == "min_atr")   p.min_atr      = v;
+    else if (key == "stop")      p.stop_atr     = v;
+    else if (key == "target")    p.target_atr   = v;
+    else if (key == "trail")     p.trailing_pct = v;
+    else if (key == "max_loss")       p.max_daily_loss = -std::abs(v);
+    else if (key == "max_trade_loss") p.max_trade_loss = -std::abs(v);
+    else if (key == "max_trades")     p.max_trades     = (int)v;
+    else return false;
+    return true;
+}
+
+// ── Contract Specs (CME equity index futures) ───────────────────────────────
+// The sim_* fields drive the simulated market for the instrument; micros
+// share their full-size contract's seed, so MES tracks ES and MNQ tracks NQ.
+struct ContractSpec {
+    const char* symbol;
+    double   tick_size;
+    double   tick_value;     // $ per tick
+    double   point_value;    // $ per point
+    double   commission;     // $ round trip
+    double   sim_start;
+    double   sim_vol;
+    uint32_t sim_seed;
+    double   sim_mean_rev = 0.001;
+};
+
+inline constexpr ContractSpec CONTRACTS[] = {
+    {"ES",  0.25, 12.50, 50.0, 1.70,  5250.0, 1.1, 42},
+    {"NQ",  0.25,  5.00, 20.0, 1.70, 18400.0, 4.0, 7},
+    {"MES", 0.25,  1.25,  5.0, 0.50,  5250.0, 1.1, 42},
+    {"MNQ", 0.25,  0.50,  2.0, 0.50, 18400.0, 4.0, 7},
+};
+
+inline const ContractSpec* find_contract(const std::string& symbol) {
+    for (const auto& c : CONTRACTS)
+        if (symbol == c.symbol) return &c;
+    return nullptr;
+}
+
+// ── Indicator Periods ───────────────────────────────────────────────────────
+// RSI/EMA/ATR take their period as a template constant (warm-up tests, the
+// EMA multiplier and the Wilder factors fold into the code) or, with the
+// default 0, from the constructor. Both produce identical values.
+template <int P>
+struct Period {
+    static_assert(P > 0, "period must be positive");
+    constexpr explicit Period(int) {}
+    static constexpr int get() { return P; }
+};
+template <>
+struct Period<0> {
+    int p;
+    constexpr explicit Period(int v) : p(v) {}
+    constexpr int get() const { return p; }
 };
 
 // ── RSI (Wilder's Smoothing — same as NinjaTrader) ─────────────────────────
+template <int P = 0>
 class RSI {
-    int period_;
+    [[no_unique_address]] Period<P> period_;
     double avg_gain_ = 0, avg_loss_ = 0, prev_ = 0, val_ = 50;
     int n_ = 0;
 public:
-    explicit RSI(int p = 14) : period_(p) {}
+    RSI() : RSI(P ? P : 14) {}
+    explicit RSI(int p) : period_(p) {}
     void update(double close) {
         if (n_ == 0) { prev_ = close; ++n_; return; }
         double chg = close - prev_;
         double g = chg > 0 ? chg : 0;
         double l = chg < 0 ? -chg : 0;
-        if (n_ <= period_) {
+        if (n_ <= period_.get()) {
             avg_gain_ += g; avg_loss_ += l;
-            if (n_ == period_) { avg_gain_ /= period_; avg_loss_ /= period_; }
+            if (n_ == period_.get()) { avg_gain_ /= period_.get(); avg_loss_ /= period_.get(); }
         } else {
-            avg_gain_ = (avg_gain_ * (period_ - 1) + g) / period_;
-            avg_loss_ = (avg_loss_ * (period_ - 1) + l) / period_;
+            avg_gain_ = (avg_gain_ * (period_.get() - 1) + g) / period_.get();
+            avg_loss_ = (avg_loss_ * (period_.get() - 1) + l) / period_.get();
         }
-        if (n_ >= period_) {
+        if (n_ >= period_.get()) {
             val_ = avg_loss_ < 1e-10 ? 100.0 : 100.0 - 100.0 / (1.0 + avg_gain_ / avg_loss_);
         }
         prev_ = close; ++n_;
     }
     double value() const { return val_; }
-    bool ready() const { return n_ > period_; }
+    bool ready() const { return n_ > period_.get(); }
+    int period() const { return period_.get(); }
+    template <class Ar> void state(Ar& ar) { ar(avg_gain_, avg_loss_, prev_, val_, n_); }
 };
 
 // ── EMA ─────────────────────────────────────────────────────────────────────
+template <int P = 0>
 class EMA {
-    int period_;
+    [[no_unique_address]] Period<P> period_;
     double mult_, val_ = 0, sum_ = 0;
     int n_ = 0;
+
+    double mult() const {
+        if constexpr (P > 0) return 2.0 / (P + 1);
+        else return mult_;
+    }
 public:
-    explicit EMA(int p) : period_(p), mult_(2.0 / (p + 1)) {}
+    EMA() requires (P > 0) : EMA(P) {}
+    explicit EMA(int p) : period_(p), mult_(2.0 / (period_.get() + 1)) {}
     void update(double v) {
-        if (n_ < period_) { sum_ += v; ++n_; if (n_ == period_) val_ = sum_ / period_; }
-        else { val_ = (v - val_) * mult_ + val_; ++n_; }
+        if (n_ < period_.get()) { sum_ += v; ++n_; if (n_ == period_.get()) val_ = sum_ / period_.get(); }
+        else { val_ = (v - val_) * mult() + val_; ++n_; }
     }
     double value() const { return val_; }
-    bool ready() const { return n_ >= period_; }
+    bool ready() const { return n_ >= period_.get(); }
+    int period() const { return period_.get(); }
+    template <class Ar> void state(Ar& ar) { ar(val_, sum_, n_); }
 };
 
 // ── VWAP ────────────────────────────────────────────────────────────────────
@@ -96,130 +323,768 @@ public:
     double value() const { return val_; }
     bool ready() const { return cum_v_ > 0; }
     void reset() { cum_vp_ = cum_v_ = val_ = 0; }
+    template <class Ar> void state(Ar& ar) { ar(cum_vp_, cum_v_, val_); }
 };
 
 // ── ATR ─────────────────────────────────────────────────────────────────────
+template <int P = 0>
 class ATR {
-    int period_;
+    [[no_unique_address]] Period<P> period_;
     double val_ = 0, prev_c_ = 0, sum_ = 0;
     int n_ = 0;
 public:
-    explicit ATR(int p = 14) : period_(p) {}
+    ATR() : ATR(P ? P : 14) {}
+    explicit ATR(int p) : period_(p) {}
     void update(double h, double l, double c) {
         if (n_ == 0) { prev_c_ = c; ++n_; return; }
         double tr = std::max({h - l, std::abs(h - prev_c_), std::abs(l - prev_c_)});
-        if (n_ <= period_) { sum_ += tr; if (n_ == period_) val_ = sum_ / period_; }
-        else { val_ = (val_ * (period_ - 1) + tr) / period_; }
+        if (n_ <= period_.get()) { sum_ += tr; if (n_ == period_.get()) val_ = sum_ / period_.get(); }
+        else { val_ = (val_ * (period_.get() - 1) + tr) / period_.get(); }
         prev_c_ = c; ++n_;
     }
     double value() const { return val_; }
-    bool ready() const { return n_ > period_; }
+    bool ready() const { return n_ > period_.get(); }
+    int period() const { return period_.get(); }
+    template <class Ar> void state(Ar& ar) { ar(val_, prev_c_, sum_, n_); }
+};
+
+// ── Rolling Windows (fixed memory, O(1) / O(log N) per update) ──────────────
+// Same update/value/ready shape as the indicators above, over the last N
+// values. Storage is sized once: inline for a compile-time period, one
+// allocation at construction otherwise, so the per-bar cost never grows with
+// the window and the bar loop stays allocation-free.
+template <class T, int P>
+struct WindowBuf {
+    std::array<T, P> a{};
+    explicit WindowBuf(int) {}
+    T&       operator[](int i)       { return a[i]; }
+    const T& operator[](int i) const { return a[i]; }
+};
+template <class T>
+struct WindowBuf<T, 0> {
+    std::vector<T> a;
+    explicit WindowBuf(int n) : a(n) {}
+    T&       operator[](int i)       { return a[i]; }
+    const T& operator[](int i) const { return a[i]; }
+};
+
+// Mean / variance of the last N values (sliding Welford, population variance)
+template <int P = 0>
+class RollingStats {
+    [[no_unique_address]] Period<P> period_;
+    WindowBuf<double, P> buf_;
+    double mean_ = 0, m2_ = 0;
+    int n_ = 0, head_ = 0;
+public:
+    RollingStats() : RollingStats(P ? P : 20) {}
+    explicit RollingStats(int p) : period_(p), buf_(p) {}
+    void update(double x) {
+        const int N = period_.get();
+        if (n_ < N) {
+            ++n_;
+            double d = x - mean_;
+            mean_ += d / n_;
+            m2_ += d * (x - mean_);
+        } else {
+            double old = buf_[head_];
+            double prev = mean_;
+            mean_ += (x - old) / N;
+            m2_ = std::max(0.0, m2_ + (x - old) * (x - mean_ + old - prev));
+        }
+        buf_[head_] = x;
+        if (++head_ == N) head_ = 0;
+    }
+    double value()    const { return mean_; }
+    double mean()     const { return mean_; }
+    double variance() const { return n_ > 0 ? m2_ / n_ : 0; }
+    double stddev()   const { return std::sqrt(variance()); }
+    bool ready() const { return n_ >= period_.get(); }
+    template <class Ar> void state(Ar& ar) {
+        ar(mean_, m2_, n_, head_);
+        for (int i = 0; i < period_.get(); ++i) ar(buf_[i]);
+    }
+};
+
+// Bollinger bands: N-bar mean +/- k population standard deviations
+template <int P = 0>
+class Bollinger {
+    RollingStats<P> stats_;
+    double k_;
+public:
+    Bollinger() : Bollinger(P ? P : 20) {}
+    explicit Bollinger(int p, double k = 2.0) : stats_(p), k_(k) {}
+    void update(double close) { stats_.update(close); }
+    double value()  const { return stats_.mean(); }
+    double middle() const { return stats_.mean(); }
+    double upper()  const { return stats_.mean() + k_ * stats_.stddev(); }
+    double lower()  const { return stats_.mean() - k_ * stats_.stddev(); }
+    double width()  const { return 2 * k_ * stats_.stddev(); }
+    // 0 at the lower band, 1 at the upper; 0.5 when the bands are flat
+    double percent_b(double close) const {
+        double w = width();
+        return w > 0 ? (close - lower()) / w : 0.5;
+    }
+    bool ready() const { return stats_.ready(); }
+};
+
+// Max (Cmp = std::greater<>) or min (std::less<>) of the last N values: a
+// monotonic queue in a ring of N slots, amortized O(1) per update
+template <int P, class Cmp>
+class MonotonicWindow {
+    struct Entry { int64_t i; double v; };
+    [[no_unique_address]] Period<P> period_;
+    WindowBuf<Entry, P> q_;
+    int front_ = 0, size_ = 0;    // live entries: size_ slots from front_, wrapping
+    int64_t n_ = 0;
+    int slot(int k) const { int s = front_ + k; return s >= period_.get() ? s - period_.get() : s; }
+public:
+    explicit MonotonicWindow(int p) : period_(p), q_(p) {}
+    void update(double x) {
+        if (size_ > 0 && q_[front_].i <= n_ - period_.get()) {   // leaves the window
+            front_ = slot(1);
+            --size_;
+        }
+        while (size_ > 0 && !Cmp{}(q_[slot(size_ - 1)].v, x)) --size_;
+        q_[slot(size_++)] = {n_, x};
+        ++n_;
+    }
+    double value() const { return q_[front_].v; }
+    bool ready() const { return n_ >= period_.get(); }
+};
+
+// Donchian channel: highest high / lowest low of the last N bars
+template <int P = 0>
+class Donchian {
+    MonotonicWindow<P, std::greater<>> hi_;
+    MonotonicWindow<P, std::less<>>    lo_;
+public:
+    Donchian() : Donchian(P ? P : 20) {}
+    explicit Donchian(int p) : hi_(p), lo_(p) {}
+    void update(double h, double l) { hi_.update(h); lo_.update(l); }
+    double upper()  const { return hi_.value(); }
+    double lower()  const { return lo_.value(); }
+    double middle() const { return 0.5 * (hi_.value() + lo_.value()); }
+    double value()  const { return middle(); }
+    bool ready() const { return hi_.ready(); }
+};
+
+// q-quantile of the last N values, linearly interpolated between order
+// statistics (numpy's default). The window is split into a max-heap of the
+// k smallest values and a min-heap of the rest; each ring slot remembers its
+// heap position, so the outgoing value is overwritten in place and one
+// swap of the tops restores the split: O(log N) per update.
+template <int P = 0>
+class RollingQuantile {
+    [[no_unique_address]] Period<P> period_;
+    double q_;
+    WindowBuf<double, P> val_;    // by ring slot
+    WindowBuf<int, P> pos_;       // slot -> heap index; >= 0 lo, < 0 hi as ~index
+    WindowBuf<int, P> lo_, hi_;   // heaps of slots
+    int lo_n_ = 0, hi_n_ = 0, n_ = 0, head_ = 0;
+
+    // Heap order: lo keeps its largest value on top, hi its smallest
+    bool before(bool lo, int a, int b) const { return lo ? val_[a] > val_[b] : val_[a] < val_[b]; }
+    auto& heap(bool lo) { return lo ? lo_ : hi_; }
+    void place(bool lo, int i, int slot) { heap(lo)[i] = slot; pos_[slot] = lo ? i : ~i; }
+
+    void sift_up(bool lo, int i) {
+        auto& h = heap(lo);
+        int s = h[i];
+        while (i > 0) {
+            int parent = (i - 1) / 2;
+            if (!before(lo, s, h[parent])) break;
+            place(lo, i, h[parent]);
+            i = parent;
+        }
+        place(lo, i, s);
+    }
+    void sift_down(bool lo, int i) {
+        auto& h = heap(lo);
+        int n = lo ? lo_n_ : hi_n_;
+        int s = h[i];
+        for (;;) {
+            int c = 2 * i + 1;
+            if (c >= n) break;
+            if (c + 1 < n && before(lo, h[c + 1], h[c])) ++c;
+            if (!before(lo, h[c], s)) break;
+            place(lo, i, h[c]);
+            i = c;
+        }
+        place(lo, i, s);
+    }
+    void push(bool lo, int slot) {
+        int i = lo ? lo_n_++ : hi_n_++;
+        place(lo, i, slot);
+        sift_up(lo, i);
+    }
+    // Only one value can be out of order after an insert or overwrite
+    void restore_split() {
+        if (lo_n_ == 0 || hi_n_ == 0 || val_[lo_[0]] <= val_[hi_[0]]) return;
+        int a = lo_[0], b = hi_[0];
+        place(true, 0, b);
+        place(false, 0, a);
+        sift_down(true, 0);
+        sift_down(false, 0);
+    }
+    int lo_size(int n) const { return (int)(q_ * (n - 1)) + 1; }
+
+public:
+    RollingQuantile() : RollingQuantile(P ? P : 20) {}
+    explicit RollingQuantile(int p, double q = 0.5)
+        : period_(p), q_(std::clamp(q, 0.0, 1.0)), val_(p), pos_(p), lo_(p), hi_(p) {}
+
+    void update(double x) {
+        const int N = period_.get();
+        int slot = head_;
+        if (++head_ == N) head_ = 0;
+        val_[slot] = x;
+        if (n_ < N) {
+            ++n_;
+            push(true, slot);
+            restore_split();
+            if (lo_n_ > lo_size(n_)) {            // hand the largest low value over
+                int top = lo_[0];
+                place(true, 0, lo_[--lo_n_]);
+                if (lo_n_ > 0) sift_down(true, 0);
+                push(false, top);
+            }
+            return;
+        }
+        bool lo = pos_[slot] >= 0;
+        int i = lo ? pos_[slot] : ~pos_[slot];
+        sift_up(lo, i);
+        sift_down(lo, lo ? pos_[slot] : ~pos_[slot]);
+        restore_split();
+    }
+
+    double value() const {
+        if (n_ == 0) return 0;
+        double h = q_ * (n_ - 1);
+        double frac = h - std::floor(h);
+        double a = val_[lo_[0]];
+        return frac > 0 && hi_n_ > 0 ? a + frac * (val_[hi_[0]] - a) : a;
+    }
+    bool ready() const { return n_ >= period_.get(); }
+};
+
+// ── SIMD Indicator Bank (structure-of-arrays, one lane per series) ─────────
+// Each lane is one instrument or one parameter set; one update() advances all
+// lanes with branch-free vector kernels (GCC/Clang vector extensions: AVX-512
+// or AVX2 when built with -march=native, SSE2 otherwise). Warm-up phases
+// become per-lane masks, since lanes may have different periods.
+//
+// Double mode reproduces the scalar classes bit for bit (same operations in
+// the same order). With -march=native also pass -ffp-contract=off, otherwise
+// GCC may fuse multiply-adds differently in the scalar and vector code (VWAP
+// then drifts by ~1e-15 relative). Float mode doubles
+// the lanes per register; measured against the double scalar classes over
+// 20k simulated bars, RSI stays within 1e-4 points, EMA/ATR within 1e-6 and
+// VWAP within 1e-5 relative (VWAP error grows with session length since its
+// sums are cumulative). --bank reports both.
+namespace simd {
+#if defined(__AVX512F__)
+    constexpr size_t BYTES = 64;
+#elif defined(__AVX__)
+    constexpr size_t BYTES = 32;
+#else
+    constexpr size_t BYTES = 16;
+#endif
+    template <class T> struct vec_of;
+    template <> struct vec_of<double> {
+        typedef double  type __attribute__((vector_size(BYTES)));
+        typedef int64_t bits __attribute__((vector_size(BYTES)));
+    };
+    template <> struct vec_of<float> {
+        typedef float   type __attribute__((vector_size(BYTES)));
+        typedef int32_t bits __attribute__((vector_size(BYTES)));
+    };
+    template <class T> using vec  = typename vec_of<T>::type;
+    template <class T> using bits = typename vec_of<T>::bits;
+    template <class T> constexpr size_t width = BYTES / sizeof(T);
+
+    template <class T> inline vec<T> splat(T x) { return vec<T>{} + x; }
+
+    template <class T> inline vec<T> abs(vec<T> x) {
+        // Clear the sign bit (matches std::abs, including -0.0)
+        return (vec<T>)((bits<T>)x & ~(bits<T>)splat<T>(-0.0f));
+    }
+
+    inline vec<double> sqrt(vec<double> x) {
+#if defined(__AVX512F__)
+        return (vec<double>)_mm512_sqrt_pd((__m512d)x);
+#elif defined(__AVX__)
+        return (vec<double>)_mm256_sqrt_pd((__m256d)x);
+#elif defined(__SSE2__)
+        return (vec<double>)_mm_sqrt_pd((__m128d)x);
+#else
+        for (size_t i = 0; i < width<double>; ++i) x[i] = std::sqrt(x[i]);
+        return x;
+#endif
+    }
+
+    // Load n <= width values, zero-padding the tail
+    template <class T> inline vec<T> load(const T* p, size_t n) {
+        vec<T> v{};
+        if (n == width<T>) std::memcpy(&v, p, sizeof(v));
+        else std::memcpy(&v, p, n * sizeof(T));
+        return v;
+    }
+    template <class T> inline void store(T* p, vec<T> v, size_t n) {
+        std::memcpy(p, &v, n * sizeof(T));
+    }
+}
+
+template <class T>
+class IndicatorBank {
+    using V = simd::vec<T>;
+    static constexpr size_t W = simd::width<T>;
+
+    size_t lanes_, blocks_;
+    int    n_ = 0;               // updates seen (shared: all lanes advance together)
+    int    warm_bars_ = 0;       // longest period: past it, every lane is smoothing
+
+    // Per-lane periods (as T, for the divisions) and EMA multipliers
+    std::vector<V> rsi_p_, atr_p_;
+    std::vector<V> ema_p_[3], ema_mult_[3];
+    std::vector<int> rsi_pi_, atr_pi_, ema_pi_[3];
+
+    // State
+    std::vector<V> avg_gain_, avg_loss_, prev_, rsi_;
+    std::vector<V> ema_sum_[3], ema_[3];
+    std::vector<V> atr_sum_, atr_, prev_c_;
+    std::vector<V> cum_vp_, cum_v_, vwap_;
+
+public:
+    enum Ema { FAST = 0, SLOW = 1, TREND = 2 };
+
+    // One StrategyParams per lane (periods only)
+    explicit IndicatorBank(const std::vector<StrategyParams>& lanes)
+        : lanes_(lanes.size()), blocks_((lanes.size() + W - 1) / W) {
+        auto zeros = [&] { return std::vector<V>(blocks_, V{}); };
+        rsi_p_ = zeros(); atr_p_ = zeros();
+        avg_gain_ = zeros(); avg_loss_ = zeros(); prev_ = zeros(); rsi_ = zeros();
+        atr_sum_ = zeros(); atr_ = zeros(); prev_c_ = zeros();
+        cum_vp_ = zeros(); cum_v_ = zeros(); vwap_ = zeros();
+        for (int e = 0; e < 3; ++e) {
+            ema_p_[e] = zeros(); ema_mult_[e] = zeros(); ema_sum_[e] = zeros(); ema_[e] = zeros();
+            ema_pi_[e].assign(lanes_, 0);
+        }
+        rsi_pi_.assign(lanes_, 0); atr_pi_.assign(lanes_, 0);
+
+        for (size_t k = 0; k < lanes_; ++k) {
+            const auto& p = lanes[k];
+            size_t b = k / W, j = k % W;
+            int ema_periods[3] = {p.ema_fast, p.ema_slow, p.ema_trend};
+            warm_bars_ = std::max({warm_bars_, p.rsi_period, p.atr_period,
+                                   p.ema_fast, p.ema_slow, p.ema_trend});
+            rsi_p_[b][j] = (T)p.rsi_period;  rsi_pi_[k] = p.rsi_period;
+            atr_p_[b][j] = (T)p.atr_period;  atr_pi_[k] = p.atr_period;
+            rsi_[b][j] = 50;
+            for (int e = 0; e < 3; ++e) {
+                ema_p_[e][b][j]    = (T)ema_periods[e];
+                ema_mult_[e][b][j] = (T)(2.0 / (ema_periods[e] + 1));
+                ema_pi_[e][k]      = ema_periods[e];
+            }
+        }
+    }
+
+    size_t lanes() const { return lanes_; }
+
+    // Advances every lane by one bar; each input array holds lanes() values
+    void update(const T* high, const T* low, const T* close, const T* volume) {
+        // n_ is shared, so the warm-up test is one uniform branch per call
+        if (n_ > warm_bars_) update_all<false>(high, low, close, volume);
+        else                 update_all<true>(high, low, close, volume);
+        ++n_;
+    }
+
+    T rsi(size_t k)          const { return rsi_[k / W][k % W]; }
+    T ema(Ema e, size_t k)   const { return ema_[e][k / W][k % W]; }
+    T atr(size_t k)          const { return atr_[k / W][k % W]; }
+    T vwap(size_t k)         const { return vwap_[k / W][k % W]; }
+    bool rsi_ready(size_t k) const { return n_ > rsi_pi_[k]; }
+    bool ema_ready(Ema e, size_t k) const { return n_ >= ema_pi_[e][k]; }
+    bool atr_ready(size_t k) const { return n_ > atr_pi_[k]; }
+    bool vwap_ready(size_t k) const { return cum_v_[k / W][k % W] > 0; }
+
+private:
+    template <bool Warm>
+    void update_all(const T* high, const T* low, const T* close, const T* volume) {
+        for (size_t b = 0; b < blocks_; ++b) {
+            size_t off = b * W, cnt = std::min(W, lanes_ - off);
+            V h = simd::load(high + off, cnt),  l = simd::load(low + off, cnt);
+            V c = simd::load(close + off, cnt), v = simd::load(volume + off, cnt);
+            if constexpr (Warm) update_warm(b, h, l, c, v);
+            else                update_steady(b, h, l, c, v);
+        }
+    }
+
+    // Steady state: every lane past warm-up, Wilder/EMA smoothing only
+    void update_steady(size_t b, V h, V l, V c, V vol) {
+        const V zero{}, one = simd::splat<T>(1);
+
+        cum_vp_[b] += c * vol; cum_v_[b] += vol;
+        vwap_[b] = cum_v_[b] > zero ? cum_vp_[b] / cum_v_[b] : vwap_[b];
+
+        for (int e = 0; e < 3; ++e)
+            ema_[e][b] = (c - ema_[e][b]) * ema_mult_[e][b] + ema_[e][b];
+
+        V p = rsi_p_[b];
+        V chg = c - prev_[b];
+        V g = chg > zero ? chg : zero;
+        V ls = chg < zero ? -chg : zero;
+        V ag = (avg_gain_[b] * (p - one) + g) / p;
+        V al = (avg_loss_[b] * (p - one) + ls) / p;
+        avg_gain_[b] = ag; avg_loss_[b] = al;
+        rsi_[b] = al < simd::splat<T>((T)1e-10) ? simd::splat<T>(100) : 100 - 100 / (one + ag / al);
+        prev_[b] = c;
+
+        V pa = atr_p_[b], pc = prev_c_[b];
+        V tr = h - l;
+        V a = simd::abs<T>(h - pc), d = simd::abs<T>(l - pc);
+        tr = tr < a ? a : tr;
+        tr = tr < d ? d : tr;
+        atr_[b] = (atr_[b] * (pa - one) + tr) / pa;
+        prev_c_[b] = c;
+    }
+
+    // Warm-up: per-lane masks select seeding vs smoothing
+    void update_warm(size_t b, V h, V l, V c, V vol) {
+        const V zero{}, one = simd::splat<T>(1);
+        const V n = simd::splat<T>((T)n_);
+
+        // VWAP
+        cum_vp_[b] += c * vol; cum_v_[b] += vol;
+        vwap_[b] = cum_v_[b] > zero ? cum_vp_[b] / cum_v_[b] : vwap_[b];
+
+        // EMA: SMA seed over the first `period` values, then exponential
+        for (int e = 0; e < 3; ++e) {
+            V p = ema_p_[e][b];
+            auto warm = n < p;
+            V sum = ema_sum_[e][b] + c;
+            ema_sum_[e][b] = warm ? sum : ema_sum_[e][b];
+            V seeded = (n + one) == p ? sum / p : ema_[e][b];
+            V smooth = (c - ema_[e][b]) * ema_mult_[e][b] + ema_[e][b];
+            ema_[e][b] = warm ? seeded : smooth;
+        }
+
+        if (n_ == 0) { prev_[b] = c; prev_c_[b] = c; return; }
+
+        // RSI (Wilder)
+        {
+            V p = rsi_p_[b];
+            V chg = c - prev_[b];
+            V g = chg > zero ? chg : zero;
+            V ls = chg < zero ? -chg : zero;
+            auto warm = n <= p;
+            V wg = avg_gain_[b] + g, wl = avg_loss_[b] + ls;
+            auto seed = n == p;
+            wg = seed ? wg / p : wg;
+            wl = seed ? wl / p : wl;
+            V sg = (avg_gain_[b] * (p - one) + g) / p;
+            V sl = (avg_loss_[b] * (p - one) + ls) / p;
+            V ag = warm ? wg : sg, al = warm ? wl : sl;
+            avg_gain_[b] = ag; avg_loss_[b] = al;
+            V val = al < simd::splat<T>((T)1e-10) ? simd::splat<T>(100) : 100 - 100 / (one + ag / al);
+            rsi_[b] = n >= p ? val : rsi_[b];
+            prev_[b] = c;
+        }
+
+        // ATR (Wilder)
+        {
+            V p = atr_p_[b];
+            V pc = prev_c_[b];
+            V tr = h - l;
+            V a = simd::abs<T>(h - pc), d = simd::abs<T>(l - pc);
+            tr = tr < a ? a : tr;
+            tr = tr < d ? d : tr;
+            auto warm = n <= p;
+            V sum = atr_sum_[b] + tr;
+            atr_sum_[b] = warm ? sum : atr_sum_[b];
+            V seeded = n == p ? sum / p : atr_[b];
+            V smooth = (atr_[b] * (p - one) + tr) / p;
+            atr_[b] = warm ? seeded : smooth;
+            prev_c_[b] = c;
+        }
+    }
+};
+
+// ── Multi-Timeframe Aggregation ─────────────────────────────────────────────
+// Rolls base bars into a higher timeframe aligned on bar time, O(1) per input
+// bar. A bar completes when a base bar ends on the boundary; if a gap skips
+// the boundary it completes when the next base bar arrives in a later bucket.
+class BarAggregator {
+    int64_t tf_ns_, base_ns_;
+    int64_t end_ = 0;         // close time of the bucket being built
+    Bar     cur_{};
+    bool    open_ = false;
+    int     count_ = 0;       // completed bars
+
+public:
+    BarAggregator(int64_t tf_ns, int64_t base_ns) : tf_ns_(tf_ns), base_ns_(base_ns) {}
+
+    // Returns true when `out` holds a completed higher-timeframe bar
+    bool add(const Bar& b, Bar& out) {
+        bool done = false;
+        if (open_ && b.time >= end_) { out = cur_; done = true; open_ = false; }
+        if (!open_) {
+            int64_t start = b.time - ((b.time % tf_ns_) + tf_ns_) % tf_ns_;
+            cur_ = b;
+            cur_.index = ++count_;
+            cur_.time = start;
+            cur_.vwap = b.vwap * b.volume;     // volume-weighted sum until completion
+            end_ = start + tf_ns_;
+            open_ = true;
+        } else {
+            cur_.high = std::max(cur_.high, b.high);
+            cur_.low = std::min(cur_.low, b.low);
+            cur_.close = b.close;
+            cur_.volume += b.volume;
+            cur_.vwap += b.vwap * b.volume;
+        }
+        if (!done && b.time + base_ns_ >= end_) {
+            out = cur_;
+            done = true;
+            open_ = false;
+        }
+        if (done) out.vwap = out.volume > 0 ? out.vwap / out.volume : out.close;
+        return done;
+    }
+
+    int64_t timeframe() const { return tf_ns_; }
+};
+
+// 1m / 5m / 15m context over 5s base bars, each timeframe with its own
+// indicator set, updated only when one of its bars completes.
+class MultiTimeframe {
+public:
+    static constexpr int NUM_TF = 3;
+    static constexpr int64_t TIMEFRAMES[NUM_TF] = {60'000'000'000, 300'000'000'000, 900'000'000'000};
+    static constexpr const char* NAMES[NUM_TF] = {"1m", "5m", "15m"};
+
+    struct Frame {
+        BarAggregator agg;
+        EMA<9>  ema_fast{};
+        EMA<21> ema_slow{};
+        RSI<14> rsi{};
+        ATR<14> atr{};
+        double close = 0;
+        int bars = 0;
+        bool ready() const { return ema_slow.ready() && rsi.ready(); }
+    };
+
+private:
+    Frame frames_[NUM_TF];
+
+public:
+    explicit MultiTimeframe(int64_t base_ns = 5'000'000'000)
+        : frames_{{BarAggregator(TIMEFRAMES[0], base_ns)},
+                  {BarAggregator(TIMEFRAMES[1], base_ns)},
+                  {BarAggregator(TIMEFRAMES[2], base_ns)}} {}
+
+    void update(const Bar& base) {
+        Bar b{};
+        for (Frame& f : frames_) {
+            if (!f.agg.add(base, b)) continue;
+            f.ema_fast.update(b.close);
+            f.ema_slow.update(b.close);
+            f.rsi.update(b.close);
+            f.atr.update(b.high, b.low, b.close);
+            f.close = b.close;
+            ++f.bars;
+        }
+    }
+
+    // Trend agreement across ready timeframes, in [-1, 1]: +1 per frame with
+    // close > slow EMA and fast > slow, -1 for the mirror, 0 otherwise
+    double trend_score() const {
+        double sum = 0;
+        int n = 0;
+        for (const Frame& f : frames_) {
+            if (!f.ready()) continue;
+            double ef = f.ema_fast.value(), es = f.ema_slow.value();
+            if (f.close > es && ef > es) sum += 1;
+            else if (f.close < es && ef < es) sum -= 1;
+            ++n;
+        }
+        return n > 0 ? sum / n : 0;
+    }
+
+    const Frame& frame(int i) const { return frames_[i]; }
+};
+
+// ── Strategy Policies ───────────────────────────────────────────────────────
+// Where SignalEngine takes its periods, weights and threshold from.
+// DynamicStrategy reads StrategyParams at construction (sweeps, portfolio);
+// FixedStrategy<P> bakes P in at compile time: indicator periods become
+// template constants, weights and the threshold fold into the scoring, and
+// components with a zero weight are compiled out.
+struct DynamicStrategy {
+    static constexpr bool FIXED = false;
+    static constexpr StrategyParams PARAMS{};   // unused
+};
+
+template <StrategyParams P>
+struct FixedStrategy {
+    static constexpr bool FIXED = true;
+    static constexpr StrategyParams PARAMS = P;
 };
 
+using ProductionStrategy = FixedStrategy<StrategyParams{}>;
+
 // ── Signal Engine (Multi-Indicator Weighted Scoring) ────────────────────────
-class SignalEngine {
-    RSI  rsi_;
-    EMA  ema_fast_, ema_slow_;
-    EMA  ema_trend_;         // 50-period trend filter
-    VWAP vwap_;
-    ATR  atr_;
+template <class Strategy = DynamicStrategy>
+class BasicSignalEngine {
+    static constexpr bool FIXED = Strategy::FIXED;
+    static constexpr int period(int p) { return FIXED ? p : 0; }
+    static constexpr const StrategyParams& SP = Strategy::PARAMS;
+
+    RSI<period(SP.rsi_period)>  rsi_;
+    EMA<period(SP.ema_fast)>    ema_fast_;
+    EMA<period(SP.ema_slow)>    ema_slow_;
+    EMA<period(SP.ema_trend)>   ema_trend_;   // 50-period trend filter
+    VWAP                        vwap_;
+    ATR<period(SP.atr_period)>  atr_;
 
     double prev_ef_ = 0, prev_es_ = 0;
-    double vol_sum_ = 0;
-    int    vol_n_ = 0;
-    double avg_vol_ = 0;
+    RollingStats<20> volume_;   // mean of the 20 bars before the current one
+
+    // Weights and threshold (mtf: higher-timeframe agreement); a
+    // FixedStrategy reads SP instead and leaves this empty
+    struct Weights { double rsi, ema, vwap, mom, vol, trend, mtf, min_score, min_atr; };
+    struct Empty {};
+    [[no_unique_address]] std::conditional_t<FIXED, Empty, Weights> w_;
 
-    // Weights
-    static constexpr double W_RSI   = 0.20;
-    static constexpr double W_EMA   = 0.25;
-    static constexpr double W_VWAP  = 0.15;
-    static constexpr double W_MOM   = 0.15;
-    static constexpr double W_VOL   = 0.10;
-    static constexpr double W_TREND = 0.15;   // Trend filter
-    static constexpr double MIN_SCORE = 0.50;
+    MultiTimeframe mtf_;     // maintained only when w_mtf != 0
+
+    static constexpr bool on(double w) { return !FIXED || w != 0; }
+
+    Weights weights() const {
+        if constexpr (FIXED)
+            return {SP.w_rsi, SP.w_ema, SP.w_vwap, SP.w_mom, SP.w_vol, SP.w_trend, SP.w_mtf, SP.min_score, SP.min_atr};
+        else return w_;
+    }
 
 public:
-    SignalEngine() : rsi_(14), ema_fast_(9), ema_slow_(21), ema_trend_(50), atr_(14) {}
+    // With a FixedStrategy, `p` only matters through Strategy::PARAMS
+    explicit BasicSignalEngine(const StrategyParams& p = Strategy::PARAMS)
+        : rsi_(p.rsi_period), ema_fast_(p.ema_fast), ema_slow_(p.ema_slow),
+          ema_trend_(p.ema_trend), atr_(p.atr_period) {
+        if constexpr (!FIXED)
+            w_ = {p.w_rsi, p.w_ema, p.w_vwap, p.w_mom, p.w_vol, p.w_trend, p.w_mtf, p.min_score, p.min_atr};
+    }
+
+    // Live reweighting (periods are fixed for the engine's lifetime)
+    void set_weights(const StrategyParams& p) requires (!FIXED) {
+        w_ = {p.w_rsi, p.w_ema, p.w_vwap, p.w_mom, p.w_vol, p.w_trend, p.w_mtf, p.min_score, p.min_atr};
+    }
 
     Signal evaluate(const Bar& bar) {
+        const Weights w = weights();
         rsi_.update(bar.close);
         ema_fast_.update(bar.close);
         ema_slow_.update(bar.close);
         ema_trend_.update(bar.close);
         vwap_.update(bar.close, bar.volume);
         atr_.update(bar.high, bar.low, bar.close);
+        if (w.mtf != 0) mtf_.update(bar);
 
-        // Volume tracking
-        vol_sum_ += bar.volume; ++vol_n_;
-        if (vol_n_ > 20) { avg_vol_ = vol_sum_ / vol_n_; vol_sum_ = avg_vol_ * 19 + bar.volume; vol_n_ = 20; }
+        // Volume baseline, taken before this bar joins the window
+        double avg_vol = 0;
+        if (on(w.vol)) {
+            avg_vol = volume_.ready() ? volume_.mean() : 0;
+            volume_.update(bar.volume);
+        }
 
         if (!rsi_.ready() || !ema_fast_.ready() || !ema_slow_.ready() || !atr_.ready() || !ema_trend_.ready())
-            return {TradeAction::NONE, 0, ""};
+            return {TradeAction::NONE, 0, 0};
 
         // Anti-chop filter: don't trade in dead markets
-        if (atr_.value() < 0.50) return {TradeAction::NONE, 0, ""};
+        if (atr_.value() < w.min_atr) return {TradeAction::NONE, 0, 0};
 
         double score = 0;
-        std::string reasons;
+        uint32_t reasons = 0;
+
+        // FIXED: components with a zero weight are compiled out (no score,
+        // no reason bits). Dynamic engines evaluate all six unconditionally,
+        // a test per component costs more than it saves in sweeps.
 
         // 1. RSI momentum
-        double rsi_v = rsi_.value();
-        double rsi_score = 0;
-        if      (rsi_v < 30) rsi_score = +0.9;
-        else if (rsi_v < 40) rsi_score = +0.4;
-        else if (rsi_v > 70) rsi_score = -0.9;
-        else if (rsi_v > 60) rsi_score = -0.4;
-        score += W_RSI * rsi_score;
-        if (std::abs(rsi_score) > 0.3) reasons += (rsi_score > 0 ? "RSI_oversold " : "RSI_overbought ");
+        if (on(w.rsi)) {
+            double rsi_v = rsi_.value();
+            double rsi_score = 0;
+            if      (rsi_v < 30) rsi_score = +0.9;
+            else if (rsi_v < 40) rsi_score = +0.4;
+            else if (rsi_v > 70) rsi_score = -0.9;
+            else if (rsi_v > 60) rsi_score = -0.4;
+            score += w.rsi * rsi_score;
+            if (std::abs(rsi_score) > 0.3) reasons |= (rsi_score > 0 ? reason::RSI_OVERSOLD : reason::RSI_OVERBOUGHT);
+        }
 
         // 2. EMA crossover
-        double ef = ema_fast_.value(), es = ema_slow_.value();
-        double ema_score = 0;
-        if (prev_ef_ > 0) {
-            bool cross_up   = prev_ef_ <= prev_es_ && ef > es;
-            bool cross_down = prev_ef_ >= prev_es_ && ef < es;
-            if (cross_up)   { ema_score = +1.0; reasons += "EMA_cross_up "; }
-            if (cross_down) { ema_score = -1.0; reasons += "EMA_cross_down "; }
-            if (!cross_up && !cross_down) {
-                ema_score = ef > es ? +0.3 : -0.3;
+        if (on(w.ema)) {
+            double ef = ema_fast_.value(), es = ema_slow_.value();
+            double ema_score = 0;
+            if (prev_ef_ > 0) {
+                bool cross_up   = prev_ef_ <= prev_es_ && ef > es;
+                bool cross_down = prev_ef_ >= prev_es_ && ef < es;
+                if (cross_up)   { ema_score = +1.0; reasons |= reason::EMA_CROSS_UP; }
+                if (cross_down) { ema_score = -1.0; reasons |= reason::EMA_CROSS_DOWN; }
+                if (!cross_up && !cross_down) {
+                    ema_score = ef > es ? +0.3 : -0.3;
+                }
             }
+            prev_ef_ = ef; prev_es_ = es;
+            score += w.ema * std::clamp(ema_score, -1.0, 1.0);
         }
-        prev_ef_ = ef; prev_es_ = es;
-        score += W_EMA * std::clamp(ema_score, -1.0, 1.0);
 
         // 3. VWAP
-        if (vwap_.ready() && atr_.ready() && atr_.value() > 0) {
+        if (on(w.vwap) && vwap_.ready() && atr_.ready() && atr_.value() > 0) {
             double dist = (bar.close - vwap_.value()) / atr_.value();
             double vs = std::clamp(dist * 0.5, -1.0, 1.0);
-            score += W_VWAP * vs;
-            if (std::abs(vs) > 0.4) reasons += (vs > 0 ? "above_VWAP " : "below_VWAP ");
+            score += w.vwap * vs;
+            if (std::abs(vs) > 0.4) reasons |= (vs > 0 ? reason::ABOVE_VWAP : reason::BELOW_VWAP);
         }
 
         // 4. Momentum (price change acceleration)
-        double mom_score = 0;
-        if (bar.close > bar.open) mom_score = std::min((bar.close - bar.open) / (atr_.ready() ? atr_.value() : 1.0), 1.0);
-        else mom_score = std::max((bar.close - bar.open) / (atr_.ready() ? atr_.value() : 1.0), -1.0);
-        score += W_MOM * mom_score;
+        if (on(w.mom)) {
+            double mom_score = 0;
+            if (bar.close > bar.open) mom_score = std::min((bar.close - bar.open) / (atr_.ready() ? atr_.value() : 1.0), 1.0);
+            else mom_score = std::max((bar.close - bar.open) / (atr_.ready() ? atr_.value() : 1.0), -1.0);
+            score += w.mom * mom_score;
+        }
 
         // 5. Volume spike
-        bool vol_spike = avg_vol_ > 0 && bar.volume > 1.5 * avg_vol_;
-        double vol_score = vol_spike ? (bar.close > bar.open ? 1.0 : -1.0) : 0.0;
-        score += W_VOL * vol_score;
-        if (vol_spike) reasons += "VOL_spike ";
+        if (on(w.vol)) {
+            bool vol_spike = avg_vol > 0 && bar.volume > 1.5 * avg_vol;
+            double vol_score = vol_spike ? (bar.close > bar.open ? 1.0 : -1.0) : 0.0;
+            score += w.vol * vol_score;
+            if (vol_spike) reasons |= reason::VOL_SPIKE;
+        }
 
         // 6. Trend filter (EMA 50) — trade WITH the trend only
-        double trend_score = 0;
-        if (bar.close > ema_trend_.value()) { trend_score = +0.8; reasons += "UPTREND "; }
-        else { trend_score = -0.8; reasons += "DOWNTREND "; }
-        score += W_TREND * trend_score;
+        if (on(w.trend)) {
+            double trend_score = 0;
+            if (bar.close > ema_trend_.value()) { trend_score = +0.8; reasons |= reason::UPTREND; }
+            else { trend_score = -0.8; reasons |= reason::DOWNTREND; }
+            score += w.trend * trend_score;
+        }
+
+        // 7. Higher timeframes (1m/5m/15m) — agreement with the HTF trend
+        if (w.mtf != 0) {
+            double mtf_score = mtf_.trend_score();
+            score += w.mtf * mtf_score;
+            if (mtf_score >= 0.5)  reasons |= reason::HTF_UP;
+            if (mtf_score <= -0.5) reasons |= reason::HTF_DOWN;
+        }
 
         // Anti-trend filter: block buys in downtrend, sells in uptrend
         TradeAction action = TradeAction::NONE;
         bool uptrend = bar.close > ema_trend_.value() && ema_fast_.value() > ema_trend_.value();
         bool downtrend = bar.close < ema_trend_.value() && ema_fast_.value() < ema_trend_.value();
 
-        if (score >= MIN_SCORE && uptrend)   action = TradeAction::BUY;
-        if (score <= -MIN_SCORE && downtrend) action = TradeAction::SELL;
+        if (score >= w.min_score && uptrend)   action = TradeAction::BUY;
+        if (score <= -w.min_score && downtrend) action = TradeAction::SELL;
 
         return {action, score, reasons};
     }
@@ -229,8 +1094,30 @@ public:
     double ema21()    const { return ema_slow_.value(); }
     double vwap_val() const { return vwap_.value(); }
     double atr_val()  const { return atr_.value(); }
+    const MultiTimeframe& mtf() const { return mtf_; }
+
+    // rsi, ema fast/slow/trend, atr: what a snapshot's state depends on
+    std::array<int32_t, 5> periods() const {
+        return {rsi_.period(), ema_fast_.period(), ema_slow_.period(), ema_trend_.period(), atr_.period()};
+    }
+
+    // Snapshot: indicator values only (a production-engine snapshot restores
+    // into a parameter-driven engine), weights stay as configured
+    template <class Ar>
+    void state(Ar& ar) {
+        rsi_.state(ar);
+        ema_fast_.state(ar);
+        ema_slow_.state(ar);
+        ema_trend_.state(ar);
+        vwap_.state(ar);
+        atr_.state(ar);
+        volume_.state(ar);
+        ar(prev_ef_, prev_es_, mtf_);
+    }
 };
 
+using SignalEngine = BasicSignalEngine<>;
+
 // ── Risk Manager ────────────────────────────────────────────────────────────
 class RiskManager {
     double max_daily_loss_;
@@ -256,456 +1143,4780 @@ public:
     bool is_killed() const { return killed_; }
     double daily_pnl() const { return daily_pnl_; }
     int trades() const { return trade_count_; }
+    int max_trades() const { return max_trades_; }
+    double max_daily_loss() const { return max_daily_loss_; }
+
+    // New limits apply from the next check; today's P&L and counts are kept
+    void set_limits(double mdl, double mpt, int mt) {
+        max_daily_loss_ = mdl; max_per_trade_ = mpt; max_trades_ = mt;
+    }
+
+    // Snapshot: the day so far, not the limits
+    template <class Ar>
+    void state(Ar& ar) { ar(daily_pnl_, trade_count_, consec_losses_, killed_); }
 };
 
+// ── Counter-Based RNG (Philox4x32-10 + Box-Muller) ──────────────────────────
+// Draws are a pure function of (key, counter): there is no state to advance,
+// so any bar's numbers can be produced on any thread, in any order. One call
+// runs LANES Philox blocks side by side in simd:: registers (32-bit words
+// held in 64-bit lanes, so each round is one widening multiply per word) and
+// turns the 32 words into 32 N(0,1) samples with a branch-free Box-Muller.
+// Every lane performs the same IEEE operations, so the samples do not depend
+// on the vector width (with -march=native pass -ffp-contract=off, as above).
+namespace philox {
+
+constexpr int LANES = 8;
+constexpr int WORDS = 4 * LANES;           // outputs per call
+constexpr uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+constexpr uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+
+typedef uint64_t u64v __attribute__((vector_size(simd::BYTES)));
+using f64v = simd::vec<double>;
+constexpr int VW = (int)simd::width<double>;
+constexpr int NV = LANES / VW;              // registers per word
+
+// Full 64-bit products of the low 32 bits of each lane (one pmuludq)
+inline u64v mul32(u64v a, u64v b) {
+#if defined(__AVX512F__)
+    return (u64v)_mm512_mul_epu32((__m512i)a, (__m512i)b);
+#elif defined(__AVX2__)
+    return (u64v)_mm256_mul_epu32((__m256i)a, (__m256i)b);
+#elif defined(__SSE2__) && !defined(__AVX__)
+    return (u64v)_mm_mul_epu32((__m128i)a, (__m128i)b);
+#else
+    const u64v lo = u64v{} + 0xFFFFFFFFull;
+    return (a & lo) * (b & lo);
+#endif
+}
+
+// x[w][v] holds word w of blocks v * VW .. v * VW + VW - 1
+struct Blocks { u64v x[4][NV]; };
+
+// Blocks with counter {c0 + lane, c1, c2, c3} under key {k0, k1}
+inline void rounds(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3,
+                   uint32_t k0, uint32_t k1, Blocks& b) {
+    const u64v lo = u64v{} + 0xFFFFFFFFull, m0 = u64v{} + M0, m1 = u64v{} + M1;
+    for (int v = 0; v < NV; ++v) {
+        u64v x0, x1 = u64v{} + c1, x2 = u64v{} + c2, x3 = u64v{} + c3;
+        for (int j = 0; j < VW; ++j) x0[j] = (uint32_t)(c0 + (uint32_t)(v * VW + j));
+        uint32_t a = k0, k = k1;
+        for (int r = 0; r < 10; ++r) {
+            u64v p0 = mul32(x0, m0), p1 = mul32(x2, m1);
+            x0 = (p1 >> 32) ^ x1 ^ a;
+            x2 = (p0 >> 32) ^ x3 ^ k;
+            x1 = p1 & lo;
+            x3 = p0 & lo;
+            a += W0;
+            k += W1;
+        }
+        b.x[0][v] = x0; b.x[1][v] = x1; b.x[2][v] = x2; b.x[3][v] = x3;
+    }
+}
+
+// Raw words, out[w * LANES + lane] = word w of block `lane`
+inline void generate(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3,
+                     uint32_t k0, uint32_t k1, uint32_t out[WORDS]) {
+    Blocks b;
+    rounds(c0, c1, c2, c3, k0, k1, b);
+    for (int w = 0; w < 4; ++w)
+        for (int v = 0; v < NV; ++v)
+            for (int j = 0; j < VW; ++j) out[w * LANES + v * VW + j] = (uint32_t)b.x[w][v][j];
+}
+
+// Exact for u < 2^52
+inline f64v to_double(u64v u) {
+    return (f64v)(u | 0x4330000000000000ull) - 0x1p52;
+}
+
+// ln(x) for normal x > 0: exponent from the bits, atanh series on the
+// mantissa folded into [sqrt(1/2), sqrt(2)); |error| < 1e-13
+inline f64v log(f64v x) {
+    u64v bits = (u64v)x;
+    f64v m = (f64v)((bits & 0x000FFFFFFFFFFFFFull) | 0x3FF0000000000000ull);
+    f64v e = to_double(bits >> 52) - 1023.0;
+    auto fold = m > 1.4142135623730951;
+    m = fold ? m * 0.5 : m;
+    e = fold ? e + 1.0 : e;
+    f64v s = (m - 1.0) / (m + 1.0), s2 = s * s;
+    f64v p = s2 * (1.0 / 15) + 1.0 / 13;
+    p = p * s2 + 1.0 / 11; p = p * s2 + 1.0 / 9; p = p * s2 + 1.0 / 7;
+    p = p * s2 + 1.0 / 5;  p = p * s2 + 1.0 / 3; p = p * s2 + 1.0;
+    return 2.0 * s * p + e * 0.6931471805599453;
+}
+
+// One Box-Muller pair per lane: `ur` sets the radius, the top two bits of
+// `ua` the quadrant and the other 30 the angle within it
+inline void box_muller(u64v ur, u64v ua, f64v& z0, f64v& z1) {
+    f64v u = (to_double(ur) + 0.5) * 0x1p-32;                       // (0, 1)
+    f64v r = simd::sqrt(-2.0 * log(u));
+    f64v t = (to_double(ua & 0x3FFFFFFFull) + 0.5) * (0x1p-30 * 1.5707963267948966);
+    f64v t2 = t * t;
+    f64v s = t2 * (-1.0 / 1307674368000) + 1.0 / 6227020800;        // Taylor to t^15
+    s = s * t2 - 1.0 / 39916800; s = s * t2 + 1.0 / 362880;
+    s = s * t2 - 1.0 / 5040;     s = s * t2 + 1.0 / 120;
+    s = s * t2 - 1.0 / 6;        s = (s * t2 + 1.0) * t;
+    f64v c = t2 * (1.0 / 20922789888000) - 1.0 / 87178291200;        // and t^16
+    c = c * t2 + 1.0 / 479001600; c = c * t2 - 1.0 / 3628800;
+    c = c * t2 + 1.0 / 40320;     c = c * t2 - 1.0 / 720;
+    c = c * t2 + 1.0 / 24;        c = c * t2 - 0.5;
+    c = c * t2 + 1.0;
+
+    // Rotate by q * pi/2: odd quadrants swap sin/cos, then flip signs
+    u64v q = ua >> 30;
+    auto odd = (q & 1) != 0;
+    f64v cq = odd ? s : c, sq = odd ? c : s;
+    cq = (f64v)((u64v)cq ^ (((q + 1) & 2) << 62));
+    sq = (f64v)((u64v)sq ^ ((q & 2) << 62));
+    z0 = r * cq;
+    z1 = r * sq;
+}
+
+// WORDS N(0,1) samples; same counter/key layout as generate()
+inline void normals(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3,
+                    uint32_t k0, uint32_t k1, double out[WORDS]) {
+    Blocks b;
+    rounds(c0, c1, c2, c3, k0, k1, b);
+    for (int v = 0; v < NV; ++v) {
+        f64v z[4];
+        box_muller(b.x[0][v], b.x[2][v], z[0], z[2]);
+        box_muller(b.x[1][v], b.x[3][v], z[1], z[3]);
+        for (int w = 0; w < 4; ++w) simd::store(out + w * LANES + v * VW, z[w], VW);
+    }
+}
+
+} // namespace philox
+
 // ── Market Simulator (Brownian Motion + Mean Reversion) ─────────────────────
 class MarketSimulator {
-    std::mt19937 rng_;
-    std::normal_distribution<> noise_{0.0, 1.0};
-    double price_;
+    uint32_t seed_;
+    Ticks  price_;
     double tick_size_;
     double volatility_;
     double mean_;
     double mean_rev_strength_;
 public:
+    static constexpr int64_t BAR_NS = 5'000'000'000;  // 5-second bars
+
+    static constexpr int     TICKS_PER_BAR = 20;
+
     MarketSimulator(double start = 5250.0, double tick = 0.25, double vol = 1.1,
                     double mean_rev = 0.001, uint32_t seed = 42)
-        : rng_(seed), price_(start), tick_size_(tick), volatility_(vol),
-          mean_(start), mean_rev_strength_(mean_rev) {}
+        : seed_(seed), price_((Ticks)std::lround(start / tick)), tick_size_(tick), volatility_(vol),
+          mean_(price_), mean_rev_strength_(mean_rev) {}
 
-    Bar next_bar(int idx) {
+    Bar next_bar(int idx) { return next_bar(idx, [](const MarketEvent&) {}); }
+
+    // The bar's draws depend only on (seed, idx): [0] volume, [1..20] ticks
+    static void noise(uint32_t seed, int idx, double out[philox::WORDS]) {
+        uint64_t i = (uint64_t)(int64_t)idx;
+        philox::normals(0, (uint32_t)i, (uint32_t)(i >> 32), 0, seed, 0x51534D53u, out);   // "SMSQ"
+    }
+
+    // Same path as next_bar(idx), also pushing BAR_OPEN / TICK / BAR_CLOSE
+    // events to `sink` (each tick carries an equal share of the bar volume)
+    template <class Sink>
+    Bar next_bar(int idx, Sink&& sink) {
         // Generate 20 ticks per bar (simulate 5-second bar)
-        double open = price_;
-        double high = price_, low = price_;
-        double vol = 100 + std::abs(noise_(rng_)) * 200; // volume
-
-        for (int i = 0; i < 20; ++i) {
-            double drift = mean_rev_strength_ * (mean_ - price_);
-            double shock = volatility_ * noise_(rng_) * tick_size_;
-            price_ += drift + shock;
-            // Snap to tick
-            price_ = std::round(price_ / tick_size_) * tick_size_;
+        static_assert(TICKS_PER_BAR + 1 <= philox::WORDS, "one Philox call per bar");
+        double z[philox::WORDS];
+        noise(seed_, idx, z);
+
+        int64_t t0 = idx * BAR_NS;
+        Ticks open = price_;
+        Ticks high = price_, low = price_;
+        double vol = 100 + std::abs(z[0]) * 200; // volume
+        double tick_vol = vol / TICKS_PER_BAR;
+        sink(MarketEvent{MarketEvent::BAR_OPEN, idx, t0, open, 0});
+
+        for (int i = 0; i < TICKS_PER_BAR; ++i) {
+            double drift = mean_rev_strength_ * (mean_ - price_);   // ticks
+            double shock = volatility_ * z[i + 1];
+            price_ = (Ticks)std::lround(price_ + drift + shock);
             high = std::max(high, price_);
             low  = std::min(low, price_);
+            sink(MarketEvent{MarketEvent::TICK, idx, t0 + (i + 1) * (BAR_NS / TICKS_PER_BAR), price_, tick_vol});
         }
 
-        double close = price_;
+        Ticks close = price_;
         double vwap = (high + low + close) / 3.0; // simplified
+        sink(MarketEvent{MarketEvent::BAR_CLOSE, idx, t0 + BAR_NS, close, 0});
 
-        return {idx, open, high, low, close, vol, vwap};
+        return {idx, open, high, low, close, vol, vwap, t0};
     }
-};
-
-// ── ANSI Colors ─────────────────────────────────────────────────────────────
-namespace clr {
-    constexpr const char* RESET  = "\033[0m";
-    constexpr const char* RED    = "\033[31m";
-    constexpr const char* GREEN  = "\033[32m";
-    constexpr const char* YELLOW = "\033[33m";
-    constexpr const char* BLUE   = "\033[34m";
-    constexpr const char* CYAN   = "\033[36m";
-    constexpr const char* BOLD   = "\033[1m";
-    constexpr const char* DIM    = "\033[2m";
-}
-
-// ── Trading Engine (Orchestrator) ───────────────────────────────────────────
-class TradingEngine {
-    SignalEngine   signal_;
-    RiskManager    risk_;
-    MarketSimulator market_;
-
-    // Position state
-    Side   pos_side_ = Side::NONE;
-    double entry_price_ = 0;
-    int    entry_bar_ = 0;
-    double stop_price_ = 0;
-    double target_price_ = 0;
-    double max_favorable_ = 0;
-    double trailing_pct_ = 0.5;
-
-    // ES contract specs
-    static constexpr double TICK_SIZE  = 0.25;
-    static constexpr double TICK_VALUE = 12.50; // $12.50 per tick for ES
-    static constexpr double POINT_VALUE = 50.0; // $50 per point for ES
 
-    // Stats
-    std::vector<Trade> trades_;
-    double peak_pnl_ = 0;
-    double max_drawdown_ = 0;
+    double tick_size() const { return tick_size_; }
 
-    // Data for JSON export
-    struct BarData {
-        int idx; double close, rsi, ema9, ema21, vwap, atr;
-    };
-    struct PnlPoint { int bar; double pnl; };
-    std::vector<BarData> bar_history_;
-    std::vector<PnlPoint> equity_curve_;
+    // Snapshot: the path continues from the last price
+    template <class Ar>
+    void state(Ar& ar) { ar(price_); }
+};
 
+// ── Bar Builder (incremental OHLCV from tick events) ─────────────────────────
+// Opens at the BAR_OPEN price (last trade before the bar, as the simulator's
+// bars do), so tick-built bars match next_bar() bars on OHLC; VWAP is the
+// true tick VWAP.
+class BarBuilder {
+    Bar    bar_{};
+    double pv_ = 0;
 public:
-    TradingEngine() : risk_(-500, -150, 50) {}
+    void open(const MarketEvent& ev) {
+        bar_ = {ev.bar, ev.price, ev.price, ev.price, ev.price, 0, (double)ev.price, ev.time};
+        pv_ = 0;
+    }
+    void add(const MarketEvent& ev) {
+        if (ev.price > bar_.high) bar_.high = ev.price;
+        if (ev.price < bar_.low)  bar_.low = ev.price;
+        bar_.close = ev.price;
+        bar_.volume += ev.size;
+        pv_ += ev.price * ev.size;
+    }
+    const Bar& close() {
+        if (bar_.volume > 0) bar_.vwap = pv_ / bar_.volume;
+        return bar_;
+    }
+    const Bar& current() const { return bar_; }
+};
 
-    void run(int num_bars, bool slow_mode) {
-        print_header();
-        bar_history_.reserve(num_bars);
-        equity_curve_.reserve(100);
+// ── Order Book Simulator (L2, order-flow driven) ────────────────────────────
+// Price levels live in flat arrays indexed by tick offset from base_tick_,
+// with one occupancy bitmap per side so the next best level is a ctz/clz
+// away. Seeded agents submit limit orders (geometric distance from the
+// touch, sometimes improving a wide spread), cancels and market orders
+// (side biased back toward the start price, like MarketSimulator's mean
+// reversion). Market and marketable flow is matched level by level; every
+// fill prints a trade. next_bar() has MarketSimulator's sink interface, so
+// trades drive the tick pipeline directly.
+struct BookLevel {
+    double price;
+    int    size;
+};
 
-        for (int i = 1; i <= num_bars; ++i) {
-            Bar bar = market_.next_bar(i);
-            Signal sig = signal_.evaluate(bar);
-
-            // Store bar data for JSON
-            bar_history_.push_back({bar.index, bar.close, signal_.rsi(),
-                signal_.ema9(), signal_.ema21(), signal_.vwap_val(), signal_.atr_val()});
-
-            // Print bar info every 10 bars (or on signal/trade)
-            bool has_signal = sig.action != TradeAction::NONE;
-            bool has_exit = false;
-            std::string exit_reason;
-
-            // Check position management first
-            if (pos_side_ != Side::NONE) {
-                auto [should_exit, reason] = check_exit(bar);
-                if (should_exit) {
-                    has_exit = true;
-                    exit_reason = reason;
-                    close_position(bar, reason);
-                }
-            }
+struct BookDepth {
+    static constexpr int LEVELS = 10;
+    BookLevel bids[LEVELS], asks[LEVELS];
+    int n_bids = 0, n_asks = 0;
+};
 
-            // Print bar
-            if (i % 10 == 0 || has_signal || has_exit || i <= 5) {
-                print_bar(bar, sig);
-            }
+struct BookParams {
+    double   start         = 5250.0;
+    double   tick          = 0.25;
+    double   events_per_sec = 2000;   // book events (adds + cancels + markets)
+    double   p_limit       = 0.55;
+    double   p_cancel      = 0.33;    // remainder are market orders
+    double   cancel_frac   = 0.3;     // a cancel removes up to this share of a level
+    double   depth_decay   = 0.35;    // geometric: P(level k) ~ (1-d)^k
+    double   mean_size     = 4;       // limit order size (geometric)
+    double   market_size   = 3;       // market order size (geometric)
+    double   mean_rev      = 0.0005;  // buy-probability tilt per tick from start
+    uint64_t seed          = 42;
+};
 
-            // Print exit
-            if (has_exit) {
-                const auto& t = trades_.back();
-                std::printf("  %s>>> EXIT %s  @ %.2f | P&L: %s$%.2f%s (%s)%s\n",
-                    clr::BOLD,
-                    t.side == Side::LONG ? "LONG " : "SHORT",
-                    t.exit_price,
-                    t.pnl >= 0 ? clr::GREEN : clr::RED,
-                    t.pnl, clr::RESET,
-                    t.exit_reason.c_str(), clr::RESET);
-            }
+class BookSimulator {
+    static constexpr int N = 8192;                // levels in the window
+    static constexpr int WORDS = N / 64;
+    enum { BID = 0, ASK = 1 };
 
-            // Try to enter new position
-            if (pos_side_ == Side::NONE && has_signal && risk_.can_trade()) {
-                open_position(bar, sig);
-                std::printf("  %s>>> ENTRY %s @ %.2f | Stop: %.2f | Target: %.2f | Score: %.2f%s\n",
-                    clr::BOLD,
-                    sig.action == TradeAction::BUY ? "LONG " : "SHORT",
-                    entry_price_, stop_price_, target_price_, sig.score, clr::RESET);
-                std::printf("  %s    Reasons: %s%s\n", clr::DIM, sig.reasons.c_str(), clr::RESET);
-            }
+    BookParams p_;
+    int64_t  base_tick_;                          // tick number of level 0
+    int64_t  mean_tick_;
+    std::vector<int32_t>  qty_[2];
+    std::vector<uint64_t> bits_[2];
+    int      best_[2];                            // level index; -1 / N when empty
+    Ticks    last_price_;
+    uint64_t rng_[4];
+    uint64_t events_ = 0, trades_ = 0;
+    int64_t  now_ns_ = 0;
 
-            // Check circuit breaker
-            if (risk_.is_killed()) {
-                std::printf("\n  %s!!! CIRCUIT BREAKER TRIGGERED — Trading stopped !!!%s\n", clr::RED, clr::RESET);
-                break;
-            }
+    // xoshiro256** (seeded with splitmix64)
+    uint64_t next_u64() {
+        auto rotl = [](uint64_t x, int k) { return (x << k) | (x >> (64 - k)); };
+        uint64_t r = rotl(rng_[1] * 5, 7) * 9, t = rng_[1] << 17;
+        rng_[2] ^= rng_[0]; rng_[3] ^= rng_[1]; rng_[1] ^= rng_[2]; rng_[0] ^= rng_[3];
+        rng_[2] ^= t; rng_[3] = rotl(rng_[3], 45);
+        return r;
+    }
+    double uniform() { return (next_u64() >> 11) * 0x1.0p-53; }
+    int geometric(double p) {                     // 0, 1, 2, ...
+        double u = uniform();
+        return u <= 0 ? 0 : (int)(std::log(u) / std::log1p(-p));
+    }
+    int order_size(double mean) { return 1 + geometric(1.0 / mean); }
 
-            // Track drawdown
-            double pnl = risk_.daily_pnl();
-            if (pnl > peak_pnl_) peak_pnl_ = pnl;
-            double dd = pnl - peak_pnl_;
-            if (dd < max_drawdown_) max_drawdown_ = dd;
+    double price_of(int lvl) const { return (base_tick_ + lvl) * p_.tick; }
 
-            // Equity curve point on each trade
-            if (has_exit) equity_curve_.push_back({bar.index, risk_.daily_pnl()});
+    void set(int side, int lvl, int32_t q) {
+        qty_[side][lvl] = q;
+        uint64_t m = 1ull << (lvl & 63);
+        if (q > 0) bits_[side][lvl >> 6] |= m; else bits_[side][lvl >> 6] &= ~m;
+    }
+
+    // Highest occupied level <= from (bids), lowest >= from (asks)
+    int scan_down(int side, int from) const {
+        for (int w = from >> 6, sh = 63 - (from & 63); w >= 0; --w, sh = 0) {
+            uint64_t b = bits_[side][w] << sh;
+            if (b) return w * 64 + 63 - sh - __builtin_clzll(b);
+        }
+        return -1;
+    }
+    int scan_up(int side, int from) const {
+        for (int w = from >> 6, sh = from & 63; w < WORDS; ++w, sh = 0) {
+            uint64_t b = bits_[side][w] >> sh;
+            if (b) return w * 64 + sh + __builtin_ctzll(b);
+        }
+        return N;
+    }
+
+    void seed_side(int side, int from_lvl, int levels) {
+        for (int k = 0; k < levels; ++k) {
+            int lvl = side == BID ? from_lvl - k : from_lvl + k;
+            if (lvl < 0 || lvl >= N) break;
+            set(side, lvl, qty_[side][lvl] + order_size(p_.mean_size) * 4);
+        }
+    }
+
+    // Keep the touch near the middle of the window
+    void recenter() {
+        int mid = (std::max(best_[BID], 0) + std::min(best_[ASK], N - 1)) / 2;
+        int shift = mid - N / 2;
+        for (int side = 0; side < 2; ++side) {
+            std::vector<int32_t> q(N, 0);
+            for (int i = 0; i < N; ++i) {
+                int j = i - shift;
+                if (j >= 0 && j < N) q[j] = qty_[side][i];
+            }
+            qty_[side].swap(q);
+            std::fill(bits_[side].begin(), bits_[side].end(), 0);
+            for (int i = 0; i < N; ++i) if (qty_[side][i] > 0) bits_[side][i >> 6] |= 1ull << (i & 63);
+        }
+        base_tick_ += shift;
+        best_[BID] = scan_down(BID, N - 1);
+        best_[ASK] = scan_up(ASK, 0);
+    }
+
+    // Aggressive flow against `side`'s book up to `limit` level; prints trades
+    template <class Sink>
+    int match(int aggressor, int qty, int limit, int bar, Sink& sink) {
+        int book = aggressor == BID ? ASK : BID;
+        while (qty > 0) {
+            int lvl = best_[book];
+            if (lvl < 0 || lvl >= N) break;
+            if (aggressor == BID ? lvl > limit : lvl < limit) break;
+            int fill = std::min(qty, qty_[book][lvl]);
+            set(book, lvl, qty_[book][lvl] - fill);
+            qty -= fill;
+            last_price_ = (Ticks)(base_tick_ + lvl);
+            ++trades_;
+            sink(MarketEvent{MarketEvent::TICK, bar, now_ns_, last_price_, (double)fill});
+            if (qty_[book][lvl] == 0)
+                best_[book] = book == ASK ? scan_up(ASK, lvl) : scan_down(BID, lvl);
+        }
+        return qty;
+    }
+
+    template <class Sink>
+    void step(int bar, Sink& sink) {
+        double u = uniform();
+        int side = (next_u64() >> 63) ? ASK : BID;
+
+        if (u < p_.p_limit) {
+            int size = order_size(p_.mean_size);
+            int spread = best_[ASK] - best_[BID];
+            int lvl;
+            if (spread > 1 && uniform() < 0.5) lvl = side == BID ? best_[BID] + 1 : best_[ASK] - 1;
+            else {
+                int k = geometric(p_.depth_decay);
+                lvl = side == BID ? best_[BID] - k : best_[ASK] + k;
+            }
+            if (lvl < 0 || lvl >= N) return;
+            set(side, lvl, qty_[side][lvl] + size);
+            if (side == BID && lvl > best_[BID]) best_[BID] = lvl;
+            if (side == ASK && lvl < best_[ASK]) best_[ASK] = lvl;
+        } else if (u < p_.p_limit + p_.p_cancel) {
+            int k = geometric(p_.depth_decay);
+            int lvl = side == BID ? best_[BID] - k : best_[ASK] + k;
+            if (lvl < 0 || lvl >= N || qty_[side][lvl] == 0) lvl = best_[side];
+            if (lvl < 0 || lvl >= N) return;
+            int q = qty_[side][lvl];
+            // Cancels scale with resting size, which bounds the book's depth
+            int cut = std::max(1, (int)(q * uniform() * p_.cancel_frac));
+            // Never cancel the last order on the touch of a thin side
+            if (lvl == best_[side] && cut == q && (side == BID ? scan_down(BID, lvl - 1) < 0 : scan_up(ASK, lvl + 1) >= N))
+                return;
+            set(side, lvl, q - cut);
+            if (qty_[side][lvl] == 0)
+                best_[side] = side == BID ? scan_down(BID, lvl) : scan_up(ASK, lvl);
+        } else {
+            // Market order; side tilted back toward the start price
+            double mid_ticks = (base_tick_ + (best_[BID] + best_[ASK]) * 0.5) - mean_tick_;
+            double p_buy = std::clamp(0.5 - p_.mean_rev * mid_ticks, 0.2, 0.8);
+            int aggressor = uniform() < p_buy ? BID : ASK;
+            match(aggressor, order_size(p_.market_size), aggressor == BID ? N - 1 : 0, bar, sink);
+        }
+
+        // Refill a side swept bare, keep the window centred
+        if (best_[BID] < 0) seed_side(BID, best_[ASK] - 1, 10), best_[BID] = scan_down(BID, N - 1);
+        if (best_[ASK] >= N) seed_side(ASK, best_[BID] + 1, 10), best_[ASK] = scan_up(ASK, 0);
+        if (best_[BID] < N / 8 || best_[ASK] > N - N / 8) recenter();
+    }
+
+public:
+    static constexpr int64_t BAR_NS = MarketSimulator::BAR_NS;
+
+    explicit BookSimulator(const BookParams& p = {}) : p_(p) {
+        mean_tick_ = (int64_t)std::llround(p.start / p.tick);
+        base_tick_ = mean_tick_ - N / 2;
+        last_price_ = (Ticks)mean_tick_;
+        uint64_t z = p.seed;
+        for (auto& r : rng_) {                     // splitmix64
+            z += 0x9E3779B97F4A7C15ull;
+            uint64_t x = z;
+            x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+            x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+            r = x ^ (x >> 31);
+        }
+        for (int side = 0; side < 2; ++side) {
+            qty_[side].assign(N, 0);
+            bits_[side].assign(WORDS, 0);
+        }
+        seed_side(BID, N / 2 - 1, 40);
+        seed_side(ASK, N / 2 + 1, 40);
+        best_[BID] = N / 2 - 1;
+        best_[ASK] = N / 2 + 1;
+    }
+
+    Bar next_bar(int idx) { return next_bar(idx, [](const MarketEvent&) {}); }
+
+    // Runs book events for one bar interval (exponential inter-arrivals)
+    template <class Sink>
+    Bar next_bar(int idx, Sink&& sink) {
+        int64_t t0 = idx * BAR_NS, t1 = t0 + BAR_NS;
+        Bar bar{idx, last_price_, last_price_, last_price_, last_price_, 0, (double)last_price_, t0};
+        double pv = 0;
+        auto tap = [&](const MarketEvent& ev) {
+            if (ev.type == MarketEvent::TICK) {
+                bar.high = std::max(bar.high, ev.price);
+                bar.low  = std::min(bar.low, ev.price);
+                bar.close = ev.price;
+                bar.volume += ev.size;
+                pv += ev.price * ev.size;
+            }
+            sink(ev);
+        };
+
+        sink(MarketEvent{MarketEvent::BAR_OPEN, idx, t0, last_price_, 0});
+        now_ns_ = std::max(now_ns_, t0);
+        double mean_gap_ns = 1e9 / p_.events_per_sec;
+        for (;;) {
+            double u = uniform();
+            now_ns_ += 1 + (int64_t)(-std::log(u > 0 ? u : 1e-300) * mean_gap_ns);
+            if (now_ns_ >= t1) break;
+            step(idx, tap);
+            ++events_;
+        }
+        now_ns_ = t1;
+        if (bar.volume > 0) bar.vwap = pv / bar.volume;
+        sink(MarketEvent{MarketEvent::BAR_CLOSE, idx, t1, bar.close, 0});
+        return bar;
+    }
+
+    double best_bid() const { return best_[BID] >= 0 ? price_of(best_[BID]) : 0; }
+    double best_ask() const { return best_[ASK] < N ? price_of(best_[ASK]) : 0; }
+    int bid_size() const { return best_[BID] >= 0 ? qty_[BID][best_[BID]] : 0; }
+    int ask_size() const { return best_[ASK] < N ? qty_[ASK][best_[ASK]] : 0; }
+    double tick_size() const { return p_.tick; }
+    uint64_t events() const { return events_; }
+    uint64_t trades() const { return trades_; }
+
+    void depth(BookDepth& d) const {
+        d.n_bids = d.n_asks = 0;
+        for (int lvl = best_[BID]; lvl >= 0 && d.n_bids < BookDepth::LEVELS; lvl = scan_down(BID, lvl - 1))
+            d.bids[d.n_bids++] = {price_of(lvl), qty_[BID][lvl]};
+        for (int lvl = best_[ASK]; lvl < N && d.n_asks < BookDepth::LEVELS; lvl = scan_up(ASK, lvl + 1))
+            d.asks[d.n_asks++] = {price_of(lvl), qty_[ASK][lvl]};
+    }
+};
+
+// num_bars + 1 bars: the extra one is the EOD flatten bar, as in run()
+inline std::vector<Bar> simulate_bars(int num_bars, uint32_t seed = 42) {
+    std::vector<Bar> bars;
+    bars.reserve(num_bars + 1);
+    MarketSimulator market(5250.0, 0.25, 1.1, 0.001, seed);
+    for (int i = 1; i <= num_bars + 1; ++i) bars.push_back(market.next_bar(i));
+    return bars;
+}
+
+// ── Order Manager (working limit / stop / OCO orders, --orders) ─────────────
+// Working orders rest in four tick-indexed books: buy limits and sell stops
+// trigger on trades at or below their price, sell limits and buy stops at or
+// above. Each book is a window of price levels (FIFO per level, orders in one
+// slot pool) with an occupancy bitmap and its most aggressive level cached,
+// as in BookSimulator: a trade that triggers nothing costs four compares, and
+// each fill or emptied level is amortised O(1) (next level is a ctz/clz away).
+//
+// Fill model, per trade print (price, size):
+//  - market: next print, `slippage` ticks worse
+//  - stop: a print at or through the stop; fills at the print, `slippage`
+//    ticks worse
+//  - limit: a print through the limit fills it outright at the limit. Prints
+//    at the limit first work off the volume queued ahead (`queue_ahead` when
+//    it joined, or behind our own earlier orders there), then fill it.
+//  - OCO: completing one leg cancels its partner
+struct OrderParams {
+    int    levels      = 4096;    // price window in ticks (multiple of 64)
+    int    capacity    = 4096;    // working orders (at most 65535)
+    double queue_ahead = 10;      // contracts ahead when joining a limit level
+    int    slippage    = 1;       // ticks, market and stop fills
+};
+
+struct Fill {
+    uint32_t id;
+    int8_t   side;      // +1 buy / -1 sell
+    Ticks    price;
+    int      qty;
+    bool     done;      // order completely filled
+};
+
+class OrderManager {
+public:
+    enum Book : uint8_t { BUY_LIMIT, SELL_LIMIT, BUY_STOP, SELL_STOP, NUM_BOOKS, MARKET = NUM_BOOKS };
+
+private:
+    // BUY_LIMIT / SELL_STOP: best = highest level, empty = -1
+    // SELL_LIMIT / BUY_STOP: best = lowest level,  empty = levels
+    static constexpr bool below(int b) { return b == BUY_LIMIT || b == SELL_STOP; }
+    static constexpr int8_t side_of(int b) { return b == BUY_LIMIT || b == BUY_STOP ? 1 : -1; }
+
+    struct Order {
+        uint32_t id = 0;          // gen << 16 | slot; 0 while free
+        uint32_t oco = 0;         // partner, cancelled when this completes
+        uint16_t gen = 0;
+        uint8_t  book = 0;
+        int8_t   side = 0;
+        Ticks    price = 0;
+        int      qty = 0;
+        double   pos = 0;         // limits: level volume that must trade first
+        int32_t  prev = -1, next = -1;
+    };
+    struct Level {
+        int32_t head = -1, tail = -1;
+        double  traded = 0;       // prints at this price so far
+    };
+
+    OrderParams p_;
+    int   n_;                                  // levels
+    Ticks base_ = 0;                           // price of level 0
+    std::vector<Order>    orders_;
+    std::vector<int32_t>  free_;
+    std::vector<Level>    levels_[NUM_BOOKS];
+    std::vector<uint64_t> bits_[NUM_BOOKS];
+    int   best_[NUM_BOOKS];
+    Level market_;                             // market orders, FIFO
+    uint64_t submitted_ = 0, fills_ = 0, cancels_ = 0;
+
+    int empty(int b) const { return below(b) ? -1 : n_; }
+
+    int scan_down(int b, int from) const {
+        for (int w = from >> 6, sh = 63 - (from & 63); w >= 0; --w, sh = 0) {
+            uint64_t x = bits_[b][w] << sh;
+            if (x) return w * 64 + 63 - sh - __builtin_clzll(x);
+        }
+        return -1;
+    }
+    int scan_up(int b, int from) const {
+        for (int w = from >> 6, sh = from & 63; w < n_ / 64; ++w, sh = 0) {
+            uint64_t x = bits_[b][w] >> sh;
+            if (x) return w * 64 + sh + __builtin_ctzll(x);
+        }
+        return n_;
+    }
+
+    Order* find(uint32_t id) {
+        uint32_t slot = id & 0xFFFF;
+        return id && slot < orders_.size() && orders_[slot].id == id ? &orders_[slot] : nullptr;
+    }
+
+    Level& level_of(const Order& o) {
+        return o.book == MARKET ? market_ : levels_[o.book][o.price - base_];
+    }
+
+    void append(Level& lv, int32_t s) {
+        Order& o = orders_[s];
+        o.prev = lv.tail;
+        o.next = -1;
+        if (lv.tail >= 0) orders_[lv.tail].next = s; else lv.head = s;
+        lv.tail = s;
+    }
+
+    // Unlinks and frees slot s; keeps the bitmap and best level current
+    void remove(int32_t s) {
+        Order& o = orders_[s];
+        Level& lv = level_of(o);
+        if (o.prev >= 0) orders_[o.prev].next = o.next; else lv.head = o.next;
+        if (o.next >= 0) orders_[o.next].prev = o.prev; else lv.tail = o.prev;
+        if (o.book != MARKET && lv.head < 0) {
+            int b = o.book, l = o.price - base_;
+            bits_[b][l >> 6] &= ~(1ull << (l & 63));
+            if (best_[b] == l) best_[b] = below(b) ? scan_down(b, l - 1) : scan_up(b, l + 1);
+        }
+        o.id = 0;
+        free_.push_back(s);
+    }
+
+    template <class Sink>
+    void fill(int32_t s, Ticks price, int qty, Sink& sink) {
+        Order& o = orders_[s];
+        o.qty -= qty;
+        ++fills_;
+        Fill f{o.id, o.side, price, qty, o.qty == 0};
+        uint32_t oco = o.oco;
+        if (f.done) {
+            remove(s);
+            if (oco) cancel(oco);
+        }
+        sink(f);
+    }
+
+    // Empty window: re-centre it on `price`
+    void rebase(Ticks price) {
+        for (int b = 0; b < NUM_BOOKS; ++b)
+            for (Level& lv : levels_[b]) lv.traded = 0;
+        base_ = price - n_ / 2;
+    }
+
+public:
+    explicit OrderManager(const OrderParams& p = {})
+        : p_(p), n_(std::max(64, p.levels / 64 * 64)) {
+        int cap = std::clamp(p.capacity, 1, 65535);
+        orders_.resize(cap);
+        free_.reserve(cap);
+        for (int s = cap - 1; s >= 0; --s) free_.push_back(s);
+        for (int b = 0; b < NUM_BOOKS; ++b) {
+            levels_[b].assign(n_, Level{});
+            bits_[b].assign(n_ / 64, 0);
+            best_[b] = empty(b);
+        }
+    }
+
+    // Returns the order id, or 0 if the pool is full or `price` is outside
+    // the window (which re-centres whenever no limit or stop is working)
+    uint32_t submit(Book book, Ticks price, int qty) {
+        if (qty <= 0 || free_.empty()) return 0;
+        if (book != MARKET) {
+            bool idle = true;
+            for (int b = 0; b < NUM_BOOKS; ++b) idle = idle && best_[b] == empty(b);
+            if (idle && (price - base_ < 0 || price - base_ >= n_)) rebase(price);
+            if (price - base_ < 0 || price - base_ >= n_) return 0;
+        }
+        int32_t s = free_.back();
+        free_.pop_back();
+        Order& o = orders_[s];
+        o.gen = (uint16_t)(o.gen % 0xFFFF + 1);
+        o.id = (uint32_t)o.gen << 16 | (uint32_t)s;
+        o.oco = 0;
+        o.book = book;
+        o.side = book == MARKET ? 0 : side_of(book);
+        o.price = price;
+        o.qty = qty;
+        o.pos = 0;
+        ++submitted_;
+        if (book == MARKET) { append(market_, s); return o.id; }
+
+        int l = price - base_;
+        Level& lv = levels_[book][l];
+        if (book == BUY_LIMIT || book == SELL_LIMIT) {
+            o.pos = lv.traded + p_.queue_ahead;
+            if (lv.tail >= 0) o.pos = std::max(o.pos, orders_[lv.tail].pos + orders_[lv.tail].qty);
+        }
+        append(lv, s);
+        bits_[book][l >> 6] |= 1ull << (l & 63);
+        if (below(book) ? l > best_[book] : l < best_[book]) best_[book] = l;
+        return o.id;
+    }
+
+    uint32_t submit_market(int8_t side, int qty) {
+        uint32_t id = submit(MARKET, 0, qty);
+        if (id) orders_[id & 0xFFFF].side = side;
+        return id;
+    }
+
+    // Limit and stop at once, each cancelling the other when it completes
+    void link_oco(uint32_t a, uint32_t b) {
+        Order* oa = find(a);
+        Order* ob = find(b);
+        if (!oa || !ob) return;
+        oa->oco = b;
+        ob->oco = a;
+    }
+
+    bool cancel(uint32_t id) {
+        Order* o = find(id);
+        if (!o) return false;
+        if (Order* partner = find(o->oco)) partner->oco = 0;
+        remove((int32_t)(id & 0xFFFF));
+        ++cancels_;
+        return true;
+    }
+
+    // Cancel/replace at a new price (new queue position); the OCO link moves
+    // to the replacement. The replacement is placed first, so if `id` is gone
+    // or the submit fails this returns 0 and the original keeps working.
+    uint32_t modify(uint32_t id, Ticks price) {
+        Order* o = find(id);
+        if (!o) return 0;
+        if (o->price == price) return id;
+        uint32_t nid = submit((Book)o->book, price, o->qty);
+        if (!nid) return 0;
+        uint32_t oco = o->oco;      // slots never move, `o` is still the original
+        cancel(id);
+        if (oco) link_oco(nid, oco);
+        return nid;
+    }
+
+    // Matches one trade print against everything working; fills go to
+    // sink(const Fill&) as they happen
+    template <class Sink>
+    void on_trade(Ticks price, double size, Sink&& sink) {
+        const int slip = p_.slippage;
+        while (market_.head >= 0) {
+            int32_t s = market_.head;
+            fill(s, price + orders_[s].side * slip, orders_[s].qty, sink);
+        }
+
+        int l = price - base_;
+        // Stops: every level at or through the print
+        while (best_[SELL_STOP] >= 0 && best_[SELL_STOP] >= l) {
+            Level& lv = levels_[SELL_STOP][best_[SELL_STOP]];
+            fill(lv.head, price - slip, orders_[lv.head].qty, sink);
+        }
+        while (best_[BUY_STOP] < n_ && best_[BUY_STOP] <= l) {
+            Level& lv = levels_[BUY_STOP][best_[BUY_STOP]];
+            fill(lv.head, price + slip, orders_[lv.head].qty, sink);
+        }
+
+        // Limits: traded through fills outright, a print at the price goes
+        // through the queue
+        while (best_[BUY_LIMIT] >= 0 && best_[BUY_LIMIT] > l) {
+            int32_t s = levels_[BUY_LIMIT][best_[BUY_LIMIT]].head;
+            fill(s, orders_[s].price, orders_[s].qty, sink);
+        }
+        while (best_[SELL_LIMIT] < n_ && best_[SELL_LIMIT] < l) {
+            int32_t s = levels_[SELL_LIMIT][best_[SELL_LIMIT]].head;
+            fill(s, orders_[s].price, orders_[s].qty, sink);
+        }
+        if (l < 0 || l >= n_) return;
+        for (int b : {BUY_LIMIT, SELL_LIMIT}) {
+            Level& lv = levels_[b][l];
+            lv.traded += size;
+            while (lv.head >= 0) {
+                int32_t s = lv.head;
+                int q = std::min(orders_[s].qty, (int)(lv.traded - orders_[s].pos));
+                if (q <= 0) break;
+                bool partial = q < orders_[s].qty;      // print used up
+                orders_[s].pos += q;
+                fill(s, price, q, sink);                // may reuse slot s
+                if (partial) break;
+            }
+        }
+    }
+
+    size_t working() const { return orders_.size() - free_.size(); }
+    bool working(uint32_t id) const {
+        uint32_t slot = id & 0xFFFF;
+        return id && slot < orders_.size() && orders_[slot].id == id;
+    }
+    int slippage() const { return p_.slippage; }
+    uint64_t submitted() const { return submitted_; }
+    uint64_t fills() const { return fills_; }
+    uint64_t cancels() const { return cancels_; }
+};
+
+// ── Bar Store (memory-mapped, fixed-record binary format) ───────────────────
+// File layout (.qsb, native byte order):
+//   [0, 4096)            BarFileHeader
+//   [4096, +count*64)    Bar records, sorted by time
+//   [index_offset, ...)  BarIndexEntry for every INDEX_STRIDE-th record
+// Records start page-aligned and are laid out exactly as `Bar`, so a
+// read-only MAP_SHARED mapping hands out `const Bar&` with no copy or parse.
+// Mapping is lazy (replay starts instantly on any size) and the page cache is
+// shared between processes mapping the same file.
+static_assert(sizeof(Bar) == 48 && std::is_trivially_copyable_v<Bar>, "Bar is the on-disk record");
+
+struct BarFileHeader {
+    char     magic[8];          // "QSBARS1"
+    uint32_t version;
+    uint32_t record_size;       // sizeof(Bar)
+    char     symbol[16];
+    int64_t  interval_ns;
+    double   tick_size;         // price of one tick: the unit of Bar OHLC / vwap
+    uint64_t count;
+    int64_t  first_time, last_time;
+    uint64_t data_offset;
+    uint64_t index_offset;
+    uint64_t index_count;
+    uint64_t index_stride;
+};
+
+struct BarIndexEntry {
+    int64_t  time;
+    uint64_t record;
+};
+
+namespace barfile {
+    constexpr char     MAGIC[8]     = "QSBARS1";
+    constexpr uint32_t VERSION      = 2;      // 2: OHLC as Ticks
+    constexpr uint64_t DATA_OFFSET  = 4096;
+    constexpr uint64_t INDEX_STRIDE = 1024;
+}
+
+class BarStoreWriter {
+    std::FILE*    f_ = nullptr;
+    BarFileHeader hdr_{};
+    std::vector<BarIndexEntry> index_;
+    std::vector<char> buf_;
+
+public:
+    BarStoreWriter() = default;
+    BarStoreWriter(const BarStoreWriter&) = delete;
+    BarStoreWriter& operator=(const BarStoreWriter&) = delete;
+    ~BarStoreWriter() { if (f_) close(); }
+
+    bool open(const char* path, const char* symbol, int64_t interval_ns, double tick_size) {
+        f_ = std::fopen(path, "wb");
+        if (!f_) return false;
+        buf_.resize(1 << 20);
+        std::setvbuf(f_, buf_.data(), _IOFBF, buf_.size());
+
+        std::memcpy(hdr_.magic, barfile::MAGIC, sizeof(hdr_.magic));
+        hdr_.version      = barfile::VERSION;
+        hdr_.record_size  = sizeof(Bar);
+        std::strncpy(hdr_.symbol, symbol, sizeof(hdr_.symbol) - 1);
+        hdr_.interval_ns  = interval_ns;
+        hdr_.tick_size    = tick_size;
+        hdr_.data_offset  = barfile::DATA_OFFSET;
+        hdr_.index_stride = barfile::INDEX_STRIDE;
+
+        // Header is rewritten on close(); reserve its page now
+        static const char zeros[barfile::DATA_OFFSET] = {};
+        return std::fwrite(zeros, 1, sizeof(zeros), f_) == sizeof(zeros);
+    }
+
+    // Bars must arrive in time order; returns false otherwise or on I/O error
+    bool append(const Bar& bar) {
+        if (hdr_.count > 0 && bar.time < hdr_.last_time) return false;
+        if (hdr_.count % barfile::INDEX_STRIDE == 0) index_.push_back({bar.time, hdr_.count});
+        if (hdr_.count == 0) hdr_.first_time = bar.time;
+        hdr_.last_time = bar.time;
+        ++hdr_.count;
+        return std::fwrite(&bar, sizeof(Bar), 1, f_) == 1;
+    }
+
+    bool append(const Bar* bars, size_t n) {
+        for (size_t i = 0; i < n; ++i)
+            if (!append(bars[i])) return false;
+        return true;
+    }
+
+    uint64_t count() const { return hdr_.count; }
+
+    bool close() {
+        if (!f_) return false;
+        hdr_.index_offset = hdr_.data_offset + hdr_.count * sizeof(Bar);
+        hdr_.index_count  = index_.size();
+        bool ok = std::fwrite(index_.data(), sizeof(BarIndexEntry), index_.size(), f_) == index_.size()
+               && std::fseek(f_, 0, SEEK_SET) == 0
+               && std::fwrite(&hdr_, sizeof(hdr_), 1, f_) == 1;
+        ok = std::fclose(f_) == 0 && ok;
+        f_ = nullptr;
+        return ok;
+    }
+};
+
+class BarStore {
+    void*  map_ = MAP_FAILED;
+    size_t len_ = 0;
+    const BarFileHeader* hdr_   = nullptr;
+    const Bar*           bars_  = nullptr;
+    const BarIndexEntry* index_ = nullptr;
+    std::string error_;
+
+    bool fail(const std::string& msg) { error_ = msg; close(); return false; }
+
+public:
+    BarStore() = default;
+    BarStore(const BarStore&) = delete;
+    BarStore& operator=(const BarStore&) = delete;
+    ~BarStore() { close(); }
+
+    bool open(const char* path) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return fail(std::string(path) + ": " + std::strerror(errno));
+        struct stat st;
+        if (::fstat(fd, &st) != 0) { ::close(fd); return fail(std::strerror(errno)); }
+        len_ = (size_t)st.st_size;
+        if (len_ < barfile::DATA_OFFSET) { ::close(fd); return fail("file too small for a bar store header"); }
+        map_ = ::mmap(nullptr, len_, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);   // the mapping keeps the file referenced
+        if (map_ == MAP_FAILED) return fail(std::strerror(errno));
+
+        hdr_ = static_cast<const BarFileHeader*>(map_);
+        if (std::memcmp(hdr_->magic, barfile::MAGIC, sizeof(hdr_->magic)) != 0) return fail("not a bar store (bad magic)");
+        if (hdr_->version != barfile::VERSION) return fail("unsupported bar store version");
+        if (hdr_->record_size != sizeof(Bar)) return fail("record size does not match this build's Bar");
+        if (hdr_->data_offset + hdr_->count * sizeof(Bar) > len_
+            || hdr_->index_offset + hdr_->index_count * sizeof(BarIndexEntry) > len_)
+            return fail("truncated bar store");
+
+        auto* base = static_cast<const char*>(map_);
+        bars_  = reinterpret_cast<const Bar*>(base + hdr_->data_offset);
+        index_ = reinterpret_cast<const BarIndexEntry*>(base + hdr_->index_offset);
+        ::madvise(map_, len_, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    void close() {
+        if (map_ != MAP_FAILED) ::munmap(map_, len_);
+        map_ = MAP_FAILED; len_ = 0;
+        hdr_ = nullptr; bars_ = nullptr; index_ = nullptr;
+    }
+
+    const std::string& error() const { return error_; }
+    size_t size() const { return hdr_ ? hdr_->count : 0; }
+    const Bar& operator[](size_t i) const { return bars_[i]; }
+    const Bar* begin() const { return bars_; }
+    const Bar* end() const { return bars_ + size(); }
+    const char* symbol() const { return hdr_->symbol; }
+    int64_t interval_ns() const { return hdr_->interval_ns; }
+    double tick_size() const { return hdr_->tick_size; }
+
+    // First record with time >= t: binary search on the sparse index, then
+    // within one stride of records (touches only a couple of pages)
+    size_t seek(int64_t t) const {
+        size_t n = size();
+        if (n == 0 || t <= bars_[0].time) return 0;
+        const BarIndexEntry* idx_end = index_ + hdr_->index_count;
+        const BarIndexEntry* it = std::lower_bound(index_, idx_end, t,
+            [](const BarIndexEntry& e, int64_t v) { return e.time < v; });
+        size_t hi = it == idx_end ? n : (size_t)it->record;
+        size_t lo = it == index_ ? 0 : (size_t)(it - 1)->record;
+        const Bar* r = std::lower_bound(bars_ + lo, bars_ + hi, t,
+            [](const Bar& b, int64_t v) { return b.time < v; });
+        return (size_t)(r - bars_);
+    }
+};
+
+// Zero-copy replay source over a store range [from, to)
+class BarReplay {
+    const Bar* cur_;
+    const Bar* end_;
+public:
+    explicit BarReplay(const BarStore& store, size_t from = 0, size_t to = SIZE_MAX)
+        : cur_(store.begin() + std::min(from, store.size())),
+          end_(store.begin() + std::min(to, store.size())) {}
+    const Bar* next() { return cur_ < end_ ? cur_++ : nullptr; }
+    size_t remaining() const { return (size_t)(end_ - cur_); }
+};
+
+// ── ANSI Colors ─────────────────────────────────────────────────────────────
+namespace clr {
+    constexpr const char* RESET  = "\033[0m";
+    constexpr const char* RED    = "\033[31m";
+    constexpr const char* GREEN  = "\033[32m";
+    constexpr const char* YELLOW = "\033[33m";
+    constexpr const char* BLUE   = "\033[34m";
+    constexpr const char* CYAN   = "\033[36m";
+    constexpr const char* BOLD   = "\033[1m";
+    constexpr const char* DIM    = "\033[2m";
+}
+
+// ── Run Statistics ──────────────────────────────────────────────────────────
+struct RunStats {
+    int    trades = 0, wins = 0, losses = 0;
+    double net = 0, gross_profit = 0, gross_loss = 0;
+    double profit_factor = 0, max_drawdown = 0, expectancy = 0;
+};
+
+// ── Allocation Counter (--alloc-check) ─────────────────────────────────────
+// Replaces global operator new to count heap allocations per thread; the
+// check mode asserts the per-bar/per-tick loop allocates nothing.
+namespace alloc {
+    inline thread_local uint64_t count = 0;
+}
+
+void* operator new(std::size_t n) {
+    ++alloc::count;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+// GCC flags free() on operator new memory, not knowing new is malloc here
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+#pragma GCC diagnostic pop
+
+// ── Latency Histograms (per-stage, TSC-stamped) ────────────────────────────
+// Build with -DQUADSCALP_LATENCY=0 to compile the instrumentation out: the
+// recorder becomes an empty type and every stamp folds to a constant.
+#ifndef QUADSCALP_LATENCY
+#define QUADSCALP_LATENCY 1
+#endif
+
+namespace latency {
+    constexpr bool ENABLED = QUADSCALP_LATENCY != 0;
+
+    // Stages of the bar-to-order path; DECISION = signal + risk + exec of one
+    // bar, whichever threads they ran on. --pipeline also times the hops
+    // between threads and the whole path from the feed emitting a bar to its
+    // decision being made.
+    enum Stage : int { FEED, SIGNAL, RISK, EXEC, OUTPUT, DECISION, Q_SIGNAL, Q_EXEC, BAR_TO_ORDER, NUM_STAGES };
+    constexpr const char* STAGE_NAMES[NUM_STAGES] = {
+        "feed", "signal", "risk", "exec", "output", "decision", "queue>sig", "queue>exec", "bar>order"
+    };
+
+    inline uint64_t now() {
+        if constexpr (!ENABLED) return 0;
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+}
+
+// Per-bar stopwatch: lap(s) charges the time since the previous lap to stage
+// s, so interleaved stages (exec, then printing, then entry) split cleanly.
+class StageClock {
+    uint64_t last_;
+    uint64_t acc_[latency::NUM_STAGES] = {};
+    uint32_t touched_ = 0;
+    bool     on_;
+
+public:
+    explicit StageClock(bool on) : last_(on ? latency::now() : 0), on_(latency::ENABLED && on) {}
+
+    void lap(latency::Stage s) {
+        if (!on_) return;
+        uint64_t t = latency::now();
+        acc_[s] += t - last_;
+        touched_ |= 1u << s;
+        last_ = t;
+    }
+    // Time spent on `s` for this bar elsewhere, e.g. on the strategy thread
+    void charge(latency::Stage s, uint64_t ticks) {
+        if (!on_) return;
+        acc_[s] += ticks;
+        touched_ |= 1u << s;
+    }
+    bool on() const { return on_; }
+    bool touched(latency::Stage s) const { return touched_ >> s & 1; }
+    uint64_t ticks(latency::Stage s) const { return acc_[s]; }
+};
+
+// Log-linear histogram (HDR-style): exact below 64, then 32 sub-buckets per
+// power of two (~3% relative error). Fixed 15 KB, covers the full uint64 range.
+class LatencyHistogram {
+    static constexpr int SUB_BITS = 5;
+    static constexpr int SUB = 1 << SUB_BITS;
+    static constexpr int BUCKETS = (64 - SUB_BITS + 1) * SUB;
+
+    uint64_t counts_[BUCKETS] = {};
+    uint64_t total_ = 0, max_ = 0;
+
+    static int index(uint64_t v) {
+        if (v < 2 * SUB) return (int)v;
+        int shift = 63 - __builtin_clzll(v) - SUB_BITS;
+        return shift * SUB + (int)(v >> shift);
+    }
+    static uint64_t upper(int idx) {
+        if (idx < 2 * SUB) return (uint64_t)idx;
+        int shift = idx / SUB - 1;
+        uint64_t top = (uint64_t)(idx % SUB + SUB);
+        return ((top + 1) << shift) - 1;
+    }
+
+public:
+    void record(uint64_t v) {
+        ++counts_[index(v)];
+        ++total_;
+        if (v > max_) max_ = v;
+    }
+    uint64_t count() const { return total_; }
+    uint64_t max() const { return max_; }
+
+    // Highest value equivalent to the q-quantile sample, clipped to max
+    uint64_t percentile(double q) const {
+        if (total_ == 0) return 0;
+        uint64_t rank = (uint64_t)std::ceil(q * (double)total_);
+        if (rank < 1) rank = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; ++i) {
+            seen += counts_[i];
+            if (seen >= rank) return std::min(upper(i), max_);
+        }
+        return max_;
+    }
+};
+
+// One histogram per stage, in TSC ticks; converted to ns at report time
+// against steady_clock over the recorder's lifetime.
+class LatencyRecorder {
+    LatencyHistogram hist_[latency::NUM_STAGES];
+    uint64_t tsc0_;
+    std::chrono::steady_clock::time_point t0_;
+
+public:
+    LatencyRecorder() : tsc0_(latency::now()), t0_(std::chrono::steady_clock::now()) {}
+
+    void record(latency::Stage s, uint64_t ticks) { hist_[s].record(ticks); }
+    void record(const StageClock& clk) {
+        using namespace latency;
+        if (!clk.on()) return;
+        for (int s = 0; s < DECISION; ++s)
+            if (clk.touched(Stage(s))) hist_[s].record(clk.ticks(Stage(s)));
+        hist_[DECISION].record(clk.ticks(SIGNAL) + clk.ticks(RISK) + clk.ticks(EXEC));
+    }
+    const LatencyHistogram& operator[](latency::Stage s) const { return hist_[s]; }
+
+    double ns_per_tick() const {
+        auto t1 = std::chrono::steady_clock::now();
+        // Short runs: stretch the calibration window to a few ms
+        while (t1 - t0_ < std::chrono::milliseconds(5)) t1 = std::chrono::steady_clock::now();
+        uint64_t ticks = latency::now() - tsc0_;
+        double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0_).count();
+        return ticks > 0 ? ns / (double)ticks : 1.0;
+    }
+};
+
+struct NoLatencyRecorder {
+    void record(latency::Stage, uint64_t) {}
+    void record(const StageClock&) {}
+};
+
+using StageLatency = std::conditional_t<latency::ENABLED, LatencyRecorder, NoLatencyRecorder>;
+
+// ── Streaming Export (NDJSON, --stream) ─────────────────────────────────────
+// One JSON object per line, appended as the run progresses: bars, trades,
+// equity points and a running stats snapshot after each closed trade. Keys
+// and array layouts match results.json. Records are formatted with to_chars
+// into a fixed buffer and written with write(2) when it fills (and at every
+// --slow bar and the end of the run), so the cost per record is constant
+// regardless of run length.
+class NdjsonStream {
+    static constexpr size_t CAP = 1 << 16;
+    static constexpr size_t SLACK = 1024;     // longest record fits in the slack
+
+    int    fd_ = -1;
+    size_t len_ = 0;
+    std::unique_ptr<char[]> buf_;
+
+    void put(char c) { buf_[len_++] = c; }
+    void put(const char* s) { while (*s) buf_[len_++] = *s++; }
+    void put(double v, int prec = 2) {
+        auto r = std::to_chars(&buf_[len_], &buf_[CAP], v, std::chars_format::fixed, prec);
+        len_ = (size_t)(r.ptr - buf_.get());
+    }
+    void put(int64_t v) {
+        auto r = std::to_chars(&buf_[len_], &buf_[CAP], v);
+        len_ = (size_t)(r.ptr - buf_.get());
+    }
+    void end() {
+        put("}\n");
+        if (len_ >= CAP - SLACK) flush();
+    }
+
+public:
+    NdjsonStream() : buf_(new char[CAP]) {}
+    ~NdjsonStream() { close(); }
+    NdjsonStream(const NdjsonStream&) = delete;
+    NdjsonStream& operator=(const NdjsonStream&) = delete;
+
+    bool open(const char* path) {
+        close();
+        fd_ = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        return fd_ >= 0;
+    }
+
+    void flush() {
+        for (size_t off = 0; off < len_;) {
+            ssize_t n = ::write(fd_, &buf_[off], len_ - off);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            off += (size_t)n;
+        }
+        len_ = 0;
+    }
+
+    void close() {
+        if (fd_ < 0) return;
+        flush();
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    void bar(int idx, double close, double rsi, double ema9, double ema21, double vwap, double atr) {
+        put("{\"bar\":["); put((int64_t)idx);
+        for (double v : {close, rsi, ema9, ema21, vwap, atr}) { put(','); put(v); }
+        put(']'); end();
+    }
+
+    // Prices go out in points: ticks * tick_size
+    void trade(const Trade& t, double tick_size) {
+        put("{\"trade\":{\"entry_bar\":"); put((int64_t)t.entry_bar);
+        put(",\"exit_bar\":"); put((int64_t)t.exit_bar);
+        put(",\"side\":\""); put(t.side == Side::LONG ? "LONG" : "SHORT");
+        put("\",\"entry\":"); put(t.entry_price * tick_size);
+        put(",\"exit\":"); put(t.exit_price * tick_size);
+        put(",\"pnl\":"); put(t.pnl);
+        put(",\"reason\":\""); put(exit_reason_name(t.exit_reason));
+        put("\"}"); end();
+    }
+
+    void config(int version, int bar) {
+        put("{\"config\":{\"version\":"); put((int64_t)version);
+        put(",\"bar\":"); put((int64_t)bar); put('}'); end();
+    }
+
+    void equity(int bar, double pnl) {
+        put("{\"equity\":["); put((int64_t)bar); put(','); put(pnl); put(']'); end();
+    }
+
+    void stats(const RunStats& s) {
+        double win_rate = s.trades > 0 ? 100.0 * s.wins / s.trades : 0;
+        double pf = std::abs(s.gross_loss) > 0 ? s.gross_profit / std::abs(s.gross_loss) : 0;
+        put("{\"stats\":{\"trades\":"); put((int64_t)s.trades);
+        put(",\"wins\":"); put((int64_t)s.wins);
+        put(",\"losses\":"); put((int64_t)s.losses);
+        put(",\"win_rate\":"); put(win_rate, 1);
+        put(",\"net_pnl\":"); put(s.net);
+        put(",\"gross_profit\":"); put(s.gross_profit);
+        put(",\"gross_loss\":"); put(s.gross_loss);
+        put(",\"profit_factor\":"); put(pf);
+        put(",\"max_drawdown\":"); put(s.max_drawdown);
+        put(",\"expectancy\":"); put(s.expectancy);
+        put('}'); end();
+    }
+};
+
+// ── SPSC Ring (lock-free, one producer / one consumer) ──────────────────────
+// Producer and consumer indices live on separate cache lines, each with a
+// cached copy of the other side's index so the fast path touches no shared
+// line. N must be a power of two.
+template <class T, size_t N>
+class SpscRing {
+    static_assert((N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+    alignas(64) std::atomic<size_t> head_{0};   // next write (producer)
+    size_t tail_cache_ = 0;
+    alignas(64) std::atomic<size_t> tail_{0};   // next read (consumer)
+    size_t head_cache_ = 0;
+    alignas(64) T buf_[N];
+
+public:
+    bool try_push(const T& v) {
+        size_t h = head_.load(std::memory_order_relaxed);
+        if (h - tail_cache_ == N) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (h - tail_cache_ == N) return false;
+        }
+        buf_[h & (N - 1)] = v;
+        head_.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& v) {
+        size_t t = tail_.load(std::memory_order_relaxed);
+        if (t == head_cache_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (t == head_cache_) return false;
+        }
+        v = buf_[t & (N - 1)];
+        tail_.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+};
+
+// ── Console Log (async, formatted off the trading thread) ───────────────────
+// The engine pushes fixed-size binary records; a logger thread pops and
+// formats them. The producer never waits on the console: a record that finds
+// the ring full is dropped and counted, and the run reports how many were lost.
+struct LogRecord {
+    enum Type : uint8_t { BAR, ENTRY, EXIT, FLATTEN, BREAKER, CONFIG };
+    Type        type;
+    ExitReason  exit;       // EXIT
+    TradeAction action;     // BAR, ENTRY
+    Side        side;       // EXIT
+    uint32_t    reasons;    // ENTRY; config version (CONFIG)
+    int         bar;
+    double      price;      // close (BAR), fill (ENTRY/EXIT/FLATTEN)
+    double      rsi, ema9, ema21, vwap, atr;    // BAR
+    double      stop, target, score;            // ENTRY
+    double      pnl;                            // EXIT
+};
+
+class ConsoleLog {
+    static constexpr size_t CAPACITY = 1 << 14;
+
+    std::unique_ptr<SpscRing<LogRecord, CAPACITY>> ring_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> done_{0};
+    uint64_t pushed_ = 0;
+    uint64_t dropped_ = 0;      // pushes that found the ring full
+
+public:
+    ConsoleLog() : ring_(std::make_unique<SpscRing<LogRecord, CAPACITY>>()) {}
+    ~ConsoleLog() { stop(); }
+    ConsoleLog(const ConsoleLog&) = delete;
+    ConsoleLog& operator=(const ConsoleLog&) = delete;
+
+    void start() {
+        if (thread_.joinable()) return;
+        running_.store(true, std::memory_order_release);
+        thread_ = std::thread([this] { consume(); });
+    }
+
+    // Consumer exits once the ring is empty
+    void stop() {
+        if (!thread_.joinable()) return;
+        running_.store(false, std::memory_order_release);
+        thread_.join();
+    }
+
+    void push(const LogRecord& r) {
+        if (ring_->try_push(r)) ++pushed_;
+        else ++dropped_;
+    }
+
+    // Waits until everything pushed so far has been printed, so the caller
+    // can write to stdout directly afterwards
+    void drain() {
+        if (thread_.joinable())
+            while (done_.load(std::memory_order_acquire) != pushed_) std::this_thread::yield();
+        std::fflush(stdout);
+    }
+
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    void consume() {
+        LogRecord r;
+        int idle = 0;
+        for (;;) {
+            if (ring_->try_pop(r)) {
+                format(r);
+                done_.store(done_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+                idle = 0;
+                continue;
+            }
+            if (!running_.load(std::memory_order_acquire) && ring_->empty()) break;
+            if (++idle < 64) {
+                std::this_thread::yield();
+            } else {
+                std::fflush(stdout);
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+        std::fflush(stdout);
+    }
+
+    static void format(const LogRecord& r) {
+        switch (r.type) {
+        case LogRecord::BAR: {
+            const char* sig_color = clr::RESET;
+            const char* sig_char = " ";
+            if (r.action == TradeAction::BUY)  { sig_color = clr::GREEN; sig_char = "+"; }
+            if (r.action == TradeAction::SELL) { sig_color = clr::RED;   sig_char = "-"; }
+
+            // RSI color
+            const char* rsi_c = clr::RESET;
+            if (r.rsi < 30) rsi_c = clr::GREEN;
+            if (r.rsi > 70) rsi_c = clr::RED;
+
+            std::printf("  %s[%04d]%s %10.2f %s%7.1f%s %9.2f %9.2f %9.2f %9.2f %s%s%s\n",
+                clr::DIM, r.bar, clr::RESET,
+                r.price,
+                rsi_c, r.rsi, clr::RESET,
+                r.ema9, r.ema21,
+                r.vwap, r.atr,
+                sig_color, sig_char, clr::RESET);
+            break;
+        }
+        case LogRecord::EXIT:
+            std::printf("  %s>>> EXIT %s  @ %.2f | P&L: %s$%.2f%s (%s)%s\n",
+                clr::BOLD,
+                r.side == Side::LONG ? "LONG " : "SHORT",
+                r.price,
+                r.pnl >= 0 ? clr::GREEN : clr::RED,
+                r.pnl, clr::RESET,
+                exit_reason_name(r.exit), clr::RESET);
+            break;
+        case LogRecord::ENTRY: {
+            std::printf("  %s>>> ENTRY %s @ %.2f | Stop: %.2f | Target: %.2f | Score: %.2f%s\n",
+                clr::BOLD,
+                r.action == TradeAction::BUY ? "LONG " : "SHORT",
+                r.price, r.stop, r.target, r.score, clr::RESET);
+            char reasons[128];
+            std::printf("  %s    Reasons: %s%s\n", clr::DIM,
+                reason::format(r.reasons, reasons, sizeof(reasons)), clr::RESET);
+            break;
+        }
+        case LogRecord::FLATTEN:
+            std::printf("  %s>>> FLATTEN EOD @ %.2f%s\n", clr::YELLOW, r.price, clr::RESET);
+            break;
+        case LogRecord::BREAKER:
+            std::printf("\n  %s!!! CIRCUIT BREAKER TRIGGERED — Trading stopped !!!%s\n", clr::RED, clr::RESET);
+            break;
+        case LogRecord::CONFIG:
+            std::printf("  %s>>> CONFIG v%u applied at bar %d%s\n", clr::CYAN, r.reasons, r.bar, clr::RESET);
+            break;
+        }
+    }
+};
+
+// ── Shared-Memory Feed (--shm, layout in qs_feed.h) ────────────────────────
+// Publishes ticks, bars, signals, positions and fills into /dev/shm/NAME for
+// the backend (libqsfeed.so). Single writer; never waits on readers.
+class ShmFeed {
+    void*           map_ = MAP_FAILED;
+    size_t          len_ = 0;
+    qs_feed_header* hdr_ = nullptr;
+    qs_feed_record* slots_ = nullptr;
+    uint64_t        next_ = 0;
+    std::string     name_;
+    std::string     error_;
+
+public:
+    ShmFeed() = default;
+    ~ShmFeed() { close(); }
+    ShmFeed(const ShmFeed&) = delete;
+    ShmFeed& operator=(const ShmFeed&) = delete;
+
+    bool open(const char* name, const char* symbol) {
+        close();
+        name_ = std::string("/") + name;
+        int fd = shm_open(name_.c_str(), O_CREAT | O_RDWR, 0644);
+        if (fd < 0) { error_ = name_ + ": " + std::strerror(errno); return false; }
+        len_ = QS_FEED_DATA + (size_t)QS_FEED_SLOTS * sizeof(qs_feed_record);
+        if (ftruncate(fd, (off_t)len_) != 0) {
+            error_ = name_ + ": " + std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+        map_ = mmap(nullptr, len_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (map_ == MAP_FAILED) { error_ = name_ + ": " + std::strerror(errno); return false; }
+
+        // Fresh generation: clear slots, then publish the header (magic last)
+        hdr_ = static_cast<qs_feed_header*>(map_);
+        slots_ = reinterpret_cast<qs_feed_record*>(static_cast<char*>(map_) + QS_FEED_DATA);
+        __atomic_store_n(&hdr_->magic, 0, __ATOMIC_RELEASE);
+        std::memset(slots_, 0, (size_t)QS_FEED_SLOTS * sizeof(qs_feed_record));
+        hdr_->version = QS_FEED_VERSION;
+        hdr_->record_size = sizeof(qs_feed_record);
+        hdr_->slots = QS_FEED_SLOTS;
+        hdr_->writer_pid = (uint64_t)getpid();
+        std::snprintf(hdr_->symbol, sizeof(hdr_->symbol), "%s", symbol);
+        __atomic_store_n(&hdr_->head, 0, __ATOMIC_RELEASE);
+        __atomic_store_n(&hdr_->generation,
+            (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count(), __ATOMIC_RELEASE);
+        __atomic_store_n(&hdr_->magic, QS_FEED_MAGIC, __ATOMIC_RELEASE);
+        next_ = 0;
+        return true;
+    }
+
+    // Unmaps; the segment stays in /dev/shm so late readers see the last lap
+    void close() {
+        if (map_ != MAP_FAILED) munmap(map_, len_);
+        map_ = MAP_FAILED;
+        hdr_ = nullptr;
+        slots_ = nullptr;
+    }
+
+    const std::string& error() const { return error_; }
+    uint64_t published() const { return next_; }
+
+    void publish(uint8_t type, int bar, int64_t time, int8_t side, uint16_t code,
+                 double p0 = 0, double p1 = 0, double p2 = 0, double p3 = 0, double p4 = 0) {
+        qs_feed_record* s = &slots_[next_ & (QS_FEED_SLOTS - 1)];
+        __atomic_store_n(&s->seq, 0, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        s->time = time;
+        s->bar = bar;
+        s->type = type;
+        s->side = side;
+        s->code = code;
+        s->px[0] = p0; s->px[1] = p1; s->px[2] = p2; s->px[3] = p3; s->px[4] = p4;
+        __atomic_store_n(&s->seq, next_ + 1, __ATOMIC_RELEASE);
+        __atomic_store_n(&hdr_->head, ++next_, __ATOMIC_RELEASE);
+    }
+};
+
+// ── Portfolio Risk (shared by all instruments) ─────────────────────────────
+// Each instrument publishes its realized P&L and trade count into its own
+// cache line; limit checks sum the slots. Writers never share a line and
+// nothing is locked, so shards on different cores do not contend. Checks see
+// every instrument's latest publish.
+class PortfolioRisk {
+    struct alignas(64) Slot {
+        std::atomic<double> pnl{0};
+        std::atomic<int>    trades{0};
+    };
+    std::unique_ptr<Slot[]> slots_;
+    size_t n_;
+    double max_loss_;
+    int    max_trades_;
+    alignas(64) std::atomic<bool> killed_{false};
+
+public:
+    PortfolioRisk(size_t n, double max_loss, int max_trades)
+        : slots_(new Slot[n]), n_(n), max_loss_(max_loss), max_trades_(max_trades) {}
+
+    // Single writer per slot: plain load + store, no read-modify-write
+    void record(size_t slot, double pnl) {
+        Slot& s = slots_[slot];
+        s.pnl.store(s.pnl.load(std::memory_order_relaxed) + pnl, std::memory_order_release);
+        s.trades.store(s.trades.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        if (pnl < 0 && total_pnl() <= max_loss_) killed_.store(true, std::memory_order_release);
+    }
+
+    bool can_trade() const {
+        return !is_killed() && total_trades() < max_trades_ && total_pnl() > max_loss_;
+    }
+    bool is_killed() const { return killed_.load(std::memory_order_acquire); }
+
+    double total_pnl() const {
+        double sum = 0;
+        for (size_t i = 0; i < n_; ++i) sum += slots_[i].pnl.load(std::memory_order_acquire);
+        return sum;
+    }
+    int total_trades() const {
+        int sum = 0;
+        for (size_t i = 0; i < n_; ++i) sum += slots_[i].trades.load(std::memory_order_acquire);
+        return sum;
+    }
+    double max_loss() const { return max_loss_; }
+};
+
+// ── Live Config (--config, RCU-style hot reload) ────────────────────────────
+// A config file holds `key = value` lines (# starts a comment) with the
+// --grid keys plus max_loss, max_trade_loss and max_trades. ConfigWatcher
+// polls the file on its own thread, parses it there and publishes a new
+// immutable LiveConfig through ConfigChannel; the trading thread picks it up
+// at the next bar with one acquire load, without locks or I/O. Retired
+// configs are freed by the watcher once the trading thread has acknowledged
+// the newest one, so the trading thread never reads freed memory.
+struct LiveConfig {
+    StrategyParams params;
+    int version = 0;
+};
+
+inline bool parse_config(const char* path, StrategyParams& p, std::string& err) {
+    std::ifstream f(path);
+    if (!f) { err = std::string("cannot read ") + path; return false; }
+    int line_no = 0;
+    for (std::string line; std::getline(f, line);) {
+        ++line_no;
+        line = line.substr(0, line.find('#'));
+        size_t eq = line.find('=');
+        auto trim = [](std::string t) {
+            size_t b = t.find_first_not_of(" \t\r"), e = t.find_last_not_of(" \t\r");
+            return b == std::string::npos ? std::string() : t.substr(b, e - b + 1);
+        };
+        std::string key = trim(line.substr(0, eq));
+        if (key.empty()) continue;
+        std::string val = eq == std::string::npos ? std::string() : trim(line.substr(eq + 1));
+        char* end = nullptr;
+        double v = std::strtod(val.c_str(), &end);
+        if (val.empty() || *end != '\0') {
+            err = std::string(path) + ":" + std::to_string(line_no) + ": bad value for " + key;
+            return false;
+        }
+        if (!set_param(p, key, v)) {
+            err = std::string(path) + ":" + std::to_string(line_no) + ": unknown key or bad value for " + key;
+            return false;
+        }
+    }
+    return true;
+}
+
+class ConfigChannel {
+    std::atomic<const LiveConfig*> current_{nullptr};
+    std::atomic<const LiveConfig*> seen_{nullptr};    // last config the reader switched to
+    // Writer side only
+    std::unique_ptr<const LiveConfig> live_;
+    std::vector<std::unique_ptr<const LiveConfig>> retired_;
+
+public:
+    // Writer: replaces the current config; the old one is retired
+    void publish(std::unique_ptr<const LiveConfig> c) {
+        const LiveConfig* p = c.get();
+        if (live_) retired_.push_back(std::move(live_));
+        live_ = std::move(c);
+        current_.store(p, std::memory_order_release);
+        reclaim();
+    }
+
+    // Writer: frees retired configs once the reader has moved to the newest
+    void reclaim() {
+        if (!retired_.empty() && seen_.load(std::memory_order_acquire) == live_.get())
+            retired_.clear();
+    }
+
+    // Reader: the current config if it differs from `applied`, else nullptr
+    const LiveConfig* poll(const LiveConfig* applied) const {
+        const LiveConfig* p = current_.load(std::memory_order_acquire);
+        return p != applied ? p : nullptr;
+    }
+
+    // Reader: done with everything older than `c`
+    void ack(const LiveConfig* c) { seen_.store(c, std::memory_order_release); }
+
+    const LiveConfig* current() const { return current_.load(std::memory_order_acquire); }
+};
+
+class ConfigWatcher {
+    ConfigChannel& channel_;
+    std::string path_;
+    StrategyParams startup_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    int version_ = 0;
+    struct timespec mtime_{};
+    off_t size_ = -1;
+
+    bool changed() {
+        struct stat st;
+        if (::stat(path_.c_str(), &st) != 0) return false;
+        bool c = st.st_mtim.tv_sec != mtime_.tv_sec || st.st_mtim.tv_nsec != mtime_.tv_nsec
+              || st.st_size != size_;
+        mtime_ = st.st_mtim;
+        size_ = st.st_size;
+        return c;
+    }
+
+public:
+    explicit ConfigWatcher(ConfigChannel& channel) : channel_(channel) {}
+    ~ConfigWatcher() { stop(); }
+    ConfigWatcher(const ConfigWatcher&) = delete;
+    ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+    // Startup load (before the engine exists); publishes version 1
+    bool load(const char* path, StrategyParams& p, std::string& err) {
+        path_ = path;
+        changed();
+        if (!parse_config(path, p, err)) return false;
+        startup_ = p;
+        channel_.publish(std::make_unique<const LiveConfig>(LiveConfig{p, ++version_}));
+        return true;
+    }
+
+    void start(int poll_ms = 200) {
+        if (thread_.joinable()) return;
+        running_.store(true, std::memory_order_release);
+        thread_ = std::thread([this, poll_ms] {
+            while (running_.load(std::memory_order_acquire)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(poll_ms));
+                channel_.reclaim();
+                if (!changed()) continue;
+                StrategyParams p;
+                std::string err;
+                if (!parse_config(path_.c_str(), p, err)) {
+                    std::fprintf(stderr, "config: %s (keeping v%d)\n", err.c_str(), version_);
+                    continue;
+                }
+                if (p.rsi_period != startup_.rsi_period || p.ema_fast != startup_.ema_fast ||
+                    p.ema_slow != startup_.ema_slow || p.ema_trend != startup_.ema_trend ||
+                    p.atr_period != startup_.atr_period)
+                    std::fprintf(stderr, "config: indicator periods only change on restart\n");
+                channel_.publish(std::make_unique<const LiveConfig>(LiveConfig{p, ++version_}));
+                std::fprintf(stderr, "config: v%d published from %s\n", version_, path_.c_str());
+            }
+        });
+    }
+
+    void stop() {
+        if (!thread_.joinable()) return;
+        running_.store(false, std::memory_order_release);
+        thread_.join();
+    }
+};
+
+// ── Engine Snapshot (--snapshot / --restore, warm restart) ──────────────────
+// Indicator, signal, risk and position state as of a bar boundary, so a
+// restarted engine trades on its first bar instead of replaying warm-up.
+// Parameters (weights, exits, limits) are not part of it: they come from the
+// command line or --config as usual. The state is only meaningful for the
+// indicator periods it was built with and for the same bar source
+// (simulator or --data store), both of which the header records.
+//
+// File: header, then the payload in the order the state() members visit
+// fields. Written to FILE.tmp and renamed over FILE, so a crash mid-write
+// leaves the previous snapshot in place.
+namespace snapshot {
+    constexpr char     MAGIC[8] = "QSSNAP1";
+    constexpr uint32_t VERSION  = 3;      // 2: prices as Ticks, 3: bar source
+
+    // Where the bars came from; a run resumes only from the same kind of source
+    enum Source : uint32_t { SIMULATOR = 0, BAR_STORE = 1 };
+
+    struct Header {
+        char     magic[8];
+        uint32_t version;
+        uint32_t source;         // Source
+        uint32_t payload_size;
+        char     symbol[16];
+        int32_t  periods[5];     // rsi, ema fast/slow/trend, atr
+        int32_t  bar;            // last bar reflected in the state
+        uint64_t checksum;       // FNV-1a of the payload
+    };
+
+    inline uint64_t fnv1a(const char* p, size_t n) {
+        uint64_t h = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < n; ++i) { h ^= (uint8_t)p[i]; h *= 0x100000001b3ull; }
+        return h;
+    }
+
+    // Appends trivially copyable fields, and vectors of them, to `out`
+    class Writer {
+        std::vector<char>& out_;
+        template <class T>
+        void put(const T& v) {
+            static_assert(std::is_trivially_copyable_v<T>, "snapshot fields must be trivially copyable");
+            const char* p = reinterpret_cast<const char*>(&v);
+            out_.insert(out_.end(), p, p + sizeof(T));
+        }
+        template <class T>
+        void put(const std::vector<T>& v) {
+            put((uint64_t)v.size());
+            const char* p = reinterpret_cast<const char*>(v.data());
+            out_.insert(out_.end(), p, p + v.size() * sizeof(T));
+        }
+    public:
+        explicit Writer(std::vector<char>& out) : out_(out) {}
+        template <class... T> void operator()(T&... v) { (put(v), ...); }
+    };
+
+    // Reads fields back in the same order; ok() once the payload is consumed exactly
+    class Reader {
+        const char* p_;
+        const char* end_;
+        bool ok_ = true;
+        template <class T>
+        void get(T& v) {
+            static_assert(std::is_trivially_copyable_v<T>, "snapshot fields must be trivially copyable");
+            if (!ok_ || (size_t)(end_ - p_) < sizeof(T)) { ok_ = false; return; }
+            std::memcpy(&v, p_, sizeof(T));
+            p_ += sizeof(T);
+        }
+        template <class T>
+        void get(std::vector<T>& v) {
+            uint64_t n = 0;
+            get(n);
+            if (!ok_ || n > (uint64_t)(end_ - p_) / sizeof(T)) { ok_ = false; return; }
+            v.resize(n);
+            std::memcpy(v.data(), p_, n * sizeof(T));
+            p_ += n * sizeof(T);
+        }
+    public:
+        Reader(const char* p, size_t n) : p_(p), end_(p + n) {}
+        template <class... T> void operator()(T&... v) { (get(v), ...); }
+        bool ok() const { return ok_ && p_ == end_; }
+    };
+}
+
+// ── Event Journal (--journal / --verify, deterministic replay) ──────────────
+// Everything the engine reacted to, in order: market events (tick runs) or
+// bars (bar runs), config switches, and the fills it produced, each with a
+// sequence number. Replaying the inputs through a fresh engine must give the
+// same records again, byte for byte, which is what --verify checks.
+//
+// File: Header, a CONFIG record with the engine's starting parameters, then
+// records. Payloads have no implicit padding, so equal values are equal
+// bytes. Records are buffered and written in 1 MiB blocks (and at every
+// --slow bar); a crash loses at most the unwritten tail, and a truncated
+// journal replays up to its last complete record.
+namespace journal {
+    constexpr char     MAGIC[8] = "QSJRNL1";
+    constexpr uint32_t VERSION  = 1;
+
+    // The first three are MarketEvent::Type
+    enum Type : uint8_t { BAR_OPEN, TICK, BAR_CLOSE, BAR, CONFIG, FILL, FLATTEN, NUM_TYPES };
+    inline constexpr const char* TYPE_NAMES[] = {
+        "BAR_OPEN", "TICK", "BAR_CLOSE", "BAR", "CONFIG", "FILL", "FLATTEN"
+    };
+
+    enum Flags : uint32_t { TICK_MODE = 1, ORDERS = 2 };
+
+    struct Header {
+        char     magic[8];
+        uint32_t version;
+        uint32_t flags;
+        char     symbol[16];
+        double   tick_size, tick_value, commission;
+        double   queue_ahead;                    // OrderParams, with ORDERS
+        int32_t  slippage, levels, capacity, reserved;
+    };
+
+    struct RecordHeader {
+        uint64_t seq;
+        uint8_t  type;
+        uint8_t  reserved;
+        uint16_t size;        // payload bytes that follow
+        uint32_t reserved2;
+    };
+
+    struct EventRecord {      // BAR_OPEN / TICK / BAR_CLOSE
+        int64_t time;
+        double  size;
+        int32_t bar;
+        Ticks   price;
+    };
+
+    struct BarRecord {        // BAR / FLATTEN
+        int64_t time;
+        double  volume, vwap;
+        int32_t index;
+        Ticks   open, high, low, close;
+        int32_t reserved;
+    };
+
+    struct ConfigRecord {
+        int64_t version;
+        double  w_rsi, w_ema, w_vwap, w_mom, w_vol, w_trend, min_score, w_mtf, min_atr;
+        double  stop_atr, target_atr, trailing_pct, max_daily_loss, max_trade_loss;
+        int32_t rsi_period, ema_fast, ema_slow, ema_trend, atr_period, max_trades;
+    };
+
+    struct FillRecord {
+        int64_t time;
+        double  pnl;
+        int32_t bar;
+        Ticks   price;
+        int8_t  side;         // +1 buy / -1 sell
+        uint8_t reason;       // ExitReason, NONE = entry
+        int16_t qty;
+        int32_t reserved;
+    };
+
+    static_assert(sizeof(Header) == 80 && sizeof(RecordHeader) == 16 && sizeof(EventRecord) == 24 &&
+                  sizeof(BarRecord) == 48 && sizeof(ConfigRecord) == 144 && sizeof(FillRecord) == 32,
+                  "journal records must not contain padding");
+    static_assert(sizeof(StrategyParams) == 144, "new StrategyParams field: add it to ConfigRecord");
+
+    inline ConfigRecord to_record(const StrategyParams& p, int version) {
+        return {version, p.w_rsi, p.w_ema, p.w_vwap, p.w_mom, p.w_vol, p.w_trend, p.min_score, p.w_mtf,
+                p.min_atr, p.stop_atr, p.target_atr, p.trailing_pct, p.max_daily_loss, p.max_trade_loss,
+                p.rsi_period, p.ema_fast, p.ema_slow, p.ema_trend, p.atr_period, p.max_trades};
+    }
+
+    inline StrategyParams from_record(const ConfigRecord& r) {
+        StrategyParams p;
+        p.rsi_period = r.rsi_period; p.ema_fast = r.ema_fast; p.ema_slow = r.ema_slow;
+        p.ema_trend = r.ema_trend;   p.atr_period = r.atr_period;
+        p.w_rsi = r.w_rsi; p.w_ema = r.w_ema; p.w_vwap = r.w_vwap; p.w_mom = r.w_mom;
+        p.w_vol = r.w_vol; p.w_trend = r.w_trend; p.min_score = r.min_score; p.w_mtf = r.w_mtf;
+        p.min_atr = r.min_atr;
+        p.stop_atr = r.stop_atr; p.target_atr = r.target_atr; p.trailing_pct = r.trailing_pct;
+        p.max_daily_loss = r.max_daily_loss; p.max_trade_loss = r.max_trade_loss;
+        p.max_trades = r.max_trades;
+        return p;
+    }
+
+    inline BarRecord to_record(const Bar& b) {
+        return {b.time, b.volume, b.vwap, b.index, b.open, b.high, b.low, b.close, 0};
+    }
+
+    inline Bar from_record(const BarRecord& r) {
+        return {r.index, r.open, r.high, r.low, r.close, r.volume, r.vwap, r.time};
+    }
+
+    // One-line description of the record at `p` (header + payload, `n` bytes
+    // available)
+    inline std::string describe(const char* p, size_t n) {
+        RecordHeader h;
+        if (n < sizeof(h)) return "end of journal";
+        std::memcpy(&h, p, sizeof(h));
+        p += sizeof(h);
+        n -= sizeof(h);
+        auto is = [&](size_t size) { return h.size == size && n >= size; };
+        char s[160];
+        const char* name = h.type < NUM_TYPES ? TYPE_NAMES[h.type] : "?";
+        if (h.type <= BAR_CLOSE && is(sizeof(EventRecord))) {
+            EventRecord e;
+            std::memcpy(&e, p, sizeof(e));
+            std::snprintf(s, sizeof(s), "#%llu %s bar %d price %d size %g", (unsigned long long)h.seq,
+                name, e.bar, e.price, e.size);
+        } else if ((h.type == BAR || h.type == FLATTEN) && is(sizeof(BarRecord))) {
+            BarRecord b;
+            std::memcpy(&b, p, sizeof(b));
+            std::snprintf(s, sizeof(s), "#%llu %s bar %d close %d", (unsigned long long)h.seq,
+                name, b.index, b.close);
+        } else if (h.type == FILL && is(sizeof(FillRecord))) {
+            FillRecord f;
+            std::memcpy(&f, p, sizeof(f));
+            std::snprintf(s, sizeof(s), "#%llu FILL bar %d %s %d @ %d %s pnl %.2f", (unsigned long long)h.seq,
+                f.bar, f.side > 0 ? "buy" : "sell", f.qty, f.price,
+                f.reason ? exit_reason_name((ExitReason)f.reason) : "entry", f.pnl);
+        } else if (h.type == CONFIG && is(sizeof(ConfigRecord))) {
+            ConfigRecord c;
+            std::memcpy(&c, p, sizeof(c));
+            std::snprintf(s, sizeof(s), "#%llu CONFIG v%lld", (unsigned long long)h.seq, (long long)c.version);
+        } else {
+            std::snprintf(s, sizeof(s), "#%llu %s (%u bytes)", (unsigned long long)h.seq, name, h.size);
+        }
+        return s;
+    }
+
+    // Appends records to a file, or in check mode compares each against the
+    // next record of an existing journal and remembers the first difference
+    class Writer {
+        std::FILE*        f_ = nullptr;
+        std::vector<char> buf_;
+        size_t            used_ = 0;
+        uint64_t          seq_ = 0;
+        uint64_t          bytes_ = 0;
+        std::string       error_;
+        // Check mode
+        const char*       expect_ = nullptr;
+        size_t            expect_size_ = 0;
+        bool              diverged_ = false;
+        std::string       expected_, actual_;    // descriptions at the divergence
+
+        template <class P>
+        void append(Type type, const P& payload) {
+            static_assert(std::is_trivially_copyable_v<P>);
+            RecordHeader h{seq_++, type, 0, (uint16_t)sizeof(P), 0};
+            constexpr size_t n = sizeof(h) + sizeof(P);
+            if (expect_) { check(h, payload); return; }
+            if (used_ + n > buf_.size()) flush();
+            std::memcpy(buf_.data() + used_, &h, sizeof(h));
+            std::memcpy(buf_.data() + used_ + sizeof(h), &payload, sizeof(P));
+            used_ += n;
+            bytes_ += n;
+        }
+
+        template <class P>
+        void check(const RecordHeader& h, const P& payload) {
+            if (diverged_) return;
+            char rec[sizeof(h) + sizeof(P)];
+            std::memcpy(rec, &h, sizeof(h));
+            std::memcpy(rec + sizeof(h), &payload, sizeof(P));
+            if (bytes_ + sizeof(rec) <= expect_size_ && std::memcmp(expect_ + bytes_, rec, sizeof(rec)) == 0) {
+                bytes_ += sizeof(rec);
+                return;
+            }
+            diverged_ = true;
+            expected_ = describe(expect_ + bytes_, expect_size_ - bytes_);
+            actual_ = describe(rec, sizeof(rec));
+        }
+
+    public:
+        Writer() = default;
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+        ~Writer() { if (f_) close(); }
+
+        // Starts a journal at `path` for an engine built from `params`
+        bool open(const char* path, const Header& hdr, const StrategyParams& params) {
+            f_ = std::fopen(path, "wb");
+            if (!f_) { error_ = std::string(path) + ": " + std::strerror(errno); return false; }
+            buf_.resize(1 << 20);
+            if (std::fwrite(&hdr, sizeof(hdr), 1, f_) != 1) { error_ = std::strerror(errno); return false; }
+            append(CONFIG, to_record(params, 0));
+            return true;
+        }
+
+        // Check mode over the records of a loaded journal (after its header
+        // and starting CONFIG)
+        void expect(const char* records, size_t size, uint64_t first_seq) {
+            expect_ = records;
+            expect_size_ = size;
+            seq_ = first_seq;
+        }
+
+        void event(const MarketEvent& ev) {
+            append((Type)ev.type, EventRecord{ev.time, ev.size, ev.bar, ev.price});
+        }
+        void bar(const Bar& b) { append(BAR, to_record(b)); }
+        void flatten(const Bar& b) { append(FLATTEN, to_record(b)); }
+        void config(const LiveConfig& c) { append(CONFIG, to_record(c.params, c.version)); }
+        void fill(int bar, int64_t time, int8_t side, ExitReason reason, Ticks price, int qty, double pnl) {
+            append(FILL, FillRecord{time, pnl, bar, price, side, (uint8_t)reason, (int16_t)qty, 0});
+        }
+
+        void flush() {
+            if (!f_ || used_ == 0) return;
+            if (std::fwrite(buf_.data(), 1, used_, f_) != used_ && error_.empty()) error_ = std::strerror(errno);
+            used_ = 0;
+        }
+
+        bool close() {
+            flush();
+            bool ok = f_ && std::fclose(f_) == 0 && error_.empty();
+            f_ = nullptr;
+            return ok;
+        }
+
+        uint64_t records() const { return seq_; }
+        uint64_t bytes() const { return bytes_; }
+        const std::string& error() const { return error_; }
+        // Check mode: the replay produced something else, or ran past the end
+        bool diverged() const { return diverged_; }
+        bool complete() const { return !diverged_ && bytes_ == expect_size_; }
+        const std::string& expected() const { return expected_; }
+        const std::string& actual() const { return actual_; }
+        // Check mode: the first journal record the replay has not produced
+        std::string pending() const { return describe(expect_ + bytes_, expect_size_ - bytes_); }
+    };
+
+    // Sequential reader over a loaded journal; stops at a truncated record
+    class Cursor {
+        const char* p_;
+        const char* end_;
+    public:
+        Cursor(const char* p, size_t n) : p_(p), end_(p + n) {}
+
+        // Next record: header into `h`, payload pointer into `payload`
+        bool next(RecordHeader& h, const char*& payload) {
+            if ((size_t)(end_ - p_) < sizeof(h)) return false;
+            std::memcpy(&h, p_, sizeof(h));
+            if ((size_t)(end_ - p_) < sizeof(h) + h.size) return false;
+            payload = p_ + sizeof(h);
+            p_ += sizeof(h) + h.size;
+            return true;
+        }
+
+        // Type of the next complete record, NUM_TYPES at the end
+        Type peek() const {
+            RecordHeader h;
+            if ((size_t)(end_ - p_) < sizeof(h)) return NUM_TYPES;
+            std::memcpy(&h, p_, sizeof(h));
+            return (size_t)(end_ - p_) < sizeof(h) + h.size ? NUM_TYPES : (Type)h.type;
+        }
+
+        const char* pos() const { return p_; }
+    };
+
+    template <class R>
+    inline R payload(const char* p) {
+        R r;
+        std::memcpy(&r, p, sizeof(r));
+        return r;
+    }
+}
+
+// ── CPU Pinning ─────────────────────────────────────────────────────────────
+// Pins the calling thread; false if the CPU is unavailable (e.g. cpuset)
+inline bool pin_thread(int cpu) {
+    if (cpu < 0) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+// CPUs this process may run on (its affinity mask, e.g. a cpuset), ascending
+inline std::vector<int> allowed_cpus() {
+    std::vector<int> out;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return out;
+    for (int c = 0; c < CPU_SETSIZE; ++c)
+        if (CPU_ISSET(c, &set)) out.push_back(c);
+    return out;
+}
+
+// ── Pipeline (--pipeline: feed / strategy / execution threads) ──────────────
+// Staged console run. A market-data thread generates bars or tick events, a
+// strategy thread builds bars and scores them, and the execution thread (the
+// caller) runs exits, risk, entries and output. SpscRings join the stages;
+// tick events go from the feed straight to both, so stops and targets never
+// wait behind signal evaluation. Each thread can be pinned (--cpus), ideally
+// to cores kept free of other work (isolcpus / cpuset). Decisions are the
+// same as a single-threaded run, record for record (--journal / --verify).
+struct PipelineOptions {
+    int  cpus[3] = {-1, -1, -1};    // feed, strategy, execution; -1 = not pinned
+    bool pinned[3] = {};            // set by the run
+};
+
+// Strategy-stage output for one bar
+struct BarSignal {
+    Bar    bar;
+    Signal sig;
+    double rsi, ema9, ema21, vwap, atr;    // ticks, except rsi
+    const LiveConfig* config;              // switched to on this bar, or null
+    uint64_t fed, sent;                    // TSC: bar emitted by the feed / queued by the strategy
+    uint64_t scored;                       // TSC ticks the strategy spent on it (pipelined)
+};
+
+namespace pipeline {
+    template <class T>
+    struct Stamped {
+        T        v;
+        uint64_t t;    // TSC when queued
+    };
+
+    // Spins briefly, then yields: no scheduler round trip while the other
+    // side keeps up, and still progress when stages share a core
+    struct Backoff {
+        int n = 0;
+        void wait() {
+            if (++n < 64) {
+#if defined(__SSE2__)
+                _mm_pause();
+#endif
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        void reset() { n = 0; }
+    };
+}
+
+// ── Trading Engine (Orchestrator) ───────────────────────────────────────────
+struct EngineProbe;   // bench.cpp: drives the private exit/export paths
+
+// Strategy selects the signal engine: DynamicStrategy for parameter-driven
+// runs, a FixedStrategy for the compiled-in production config.
+template <class Strategy = DynamicStrategy>
+class BasicTradingEngine {
+    friend struct EngineProbe;
+
+    BasicSignalEngine<Strategy> signal_;
+    RiskManager    risk_;
+    MarketSimulator market_;
+
+    // Position state (ticks)
+    Side   pos_side_ = Side::NONE;
+    Ticks  entry_price_ = 0;
+    int    entry_bar_ = 0;
+    Ticks  stop_price_ = 0;
+    Ticks  target_price_ = 0;
+    Ticks  max_favorable_ = 0;
+    double stop_atr_;
+    double target_atr_;
+    double trailing_pct_;
+
+    // Headless mode (sweeps): no console output, no chart history
+    bool   quiet_ = false;
+
+    // Tick-driven mode: exits are managed per tick, bars built incrementally
+    bool       tick_mode_ = false;
+    bool       tick_exit_ = false;    // a tick closed the position during this bar
+    uint64_t   ticks_seen_ = 0;
+    BarBuilder builder_;
+
+    // Console output: records go to the logger thread; null = headless
+    ConsoleLog* log_ = nullptr;
+
+    // Shared-memory feed for the backend (optional)
+    ShmFeed* feed_ = nullptr;
+    int64_t  now_ = 0;          // time of the last tick/bar seen, for fills
+
+    // Live NDJSON export (console runs, optional)
+    NdjsonStream* stream_ = nullptr;
+
+    // Per-stage latency (console runs only; empty when compiled out)
+    [[no_unique_address]] StageLatency lat_;
+
+    // Contract specs (ES unless constructed otherwise)
+    ContractSpec spec_;
+
+    // Portfolio-level risk shared with other instruments (optional)
+    PortfolioRisk* portfolio_ = nullptr;
+    size_t         portfolio_slot_ = 0;
+
+    // Working orders (optional, tick-driven runs): entries go out as market
+    // orders, exits as an OCO stop/target bracket; null = instant fills
+    OrderManager* orders_ = nullptr;
+    uint32_t      entry_id_ = 0, stop_id_ = 0, target_id_ = 0;
+    Signal        pending_{};         // entry signal awaiting its fill
+    double        pending_atr_ = 0;
+
+    // Event journal (optional): inputs and fills, for --verify replays
+    journal::Writer* journal_ = nullptr;
+
+    // Live config (optional): polled once per bar by evaluate()
+    ConfigChannel*    config_ = nullptr;
+    const LiveConfig* applied_config_ = nullptr;
+
+    // Warm restart (optional): state saved every snapshot_every_ bars; bars
+    // up to resume_bar_ are already reflected in restored state
+    std::string       snapshot_path_;
+    int               snapshot_every_ = 0;
+    snapshot::Source  snapshot_source_ = snapshot::SIMULATOR;
+    std::vector<char> snapshot_buf_;
+    int               resume_bar_ = 0;
+
+    // Stats
+    std::vector<Trade> trades_;
+    RunStats totals_;                 // wins/losses and gross P&L of trades_, kept as they close
+    double peak_pnl_ = 0;
+    double max_drawdown_ = 0;
+
+    // Data for JSON export (ticks, except rsi)
+    struct BarData {
+        int idx; Ticks close; double rsi, ema9, ema21, vwap, atr;
+    };
+    struct PnlPoint { int bar; double pnl; };
+    std::vector<BarData> bar_history_;
+    std::vector<PnlPoint> equity_curve_;
+
+public:
+    explicit BasicTradingEngine(const StrategyParams& p = Strategy::PARAMS, const ContractSpec& spec = CONTRACTS[0])
+        : signal_(p), risk_(p.max_daily_loss, p.max_trade_loss, p.max_trades),
+          market_(spec.sim_start, spec.tick_size, spec.sim_vol, spec.sim_mean_rev, spec.sim_seed),
+          stop_atr_(p.stop_atr), target_atr_(p.target_atr), trailing_pct_(p.trailing_pct),
+          spec_(spec) {
+        // Bounded by the risk limit, so the bar loop never grows these
+        trades_.reserve(risk_.max_trades());
+        equity_curve_.reserve(risk_.max_trades());
+    }
+
+    void run(int num_bars, bool slow_mode) {
+        print_header("ES (simulated)");
+        bar_history_.reserve(num_bars);
+        equity_curve_.reserve(100);
+
+        for (int i = resume_bar_ + 1; i <= num_bars; ++i) {
+            uint64_t t0 = latency::now();
+            Bar bar = market_.next_bar(i);
+            lat_.record(latency::FEED, latency::now() - t0);
+            if (!on_bar(bar)) break;
+
+            if (slow_mode) pace();
+        }
+
+        // Flatten if still in position
+        if (pos_side_ != Side::NONE) flatten(market_.next_bar(num_bars + 1));
+
+        finish();
+    }
+
+    // Tick-driven console run: simulator events flow through on_event(), so
+    // stops/targets/trail see every trade and SignalEngine sees bars built
+    // incrementally from those trades.
+    void run_ticks(int num_bars, bool slow_mode) {
+        run_ticks(market_, "ES (simulated, ticks)", num_bars, slow_mode);
+    }
+
+    // Same, over any market with next_bar(idx, sink), e.g. BookSimulator
+    template <class Market>
+    void run_ticks(Market& market, const char* label, int num_bars, bool slow_mode) {
+        print_header(label);
+        tick_mode_ = true;
+        bar_history_.reserve(num_bars);
+        equity_curve_.reserve(100);
+
+        bool live = true;
+        for (int i = 1; i <= num_bars && live; ++i) {
+            market.next_bar(i, [&](const MarketEvent& ev) { live = on_event(ev) && live; });
+            if (slow_mode) pace();
+        }
+
+        if (pos_side_ != Side::NONE) flatten(market.next_bar(num_bars + 1));
+
+        finish();
+    }
+
+    void run_pipelined(int num_bars, bool ticks, bool slow_mode, PipelineOptions& opt) {
+        run_pipelined(market_, ticks ? "ES (simulated, ticks, pipelined)" : "ES (simulated, pipelined)",
+            num_bars, ticks, slow_mode, opt);
+    }
+
+    // run() / run_ticks() as three pinned stages (see Pipeline). The feed
+    // thread owns `market` until it exits; evaluate() and the bar builder
+    // belong to the strategy thread, everything else to this one.
+    template <class Market>
+    void run_pipelined(Market& market, const char* label, int num_bars, bool ticks, bool slow_mode,
+                       PipelineOptions& opt) {
+        print_header(label);
+        tick_mode_ = ticks;
+        bar_history_.reserve(num_bars);
+        equity_curve_.reserve(100);
+
+        using Event = pipeline::Stamped<MarketEvent>;
+        using BarMsg = pipeline::Stamped<Bar>;
+        auto to_strategy = std::make_unique<SpscRing<Event, 8192>>();
+        auto to_exec     = std::make_unique<SpscRing<Event, 8192>>();
+        auto bars        = std::make_unique<SpscRing<BarMsg, 1024>>();
+        auto signals     = std::make_unique<SpscRing<BarSignal, 1024>>();
+        std::atomic<bool> stop{false}, fed{false}, scored{false};
+
+        // Blocking push; gives up once execution has stopped
+        auto push = [&](auto& ring, const auto& v) {
+            pipeline::Backoff b;
+            while (!ring.try_push(v)) {
+                if (stop.load(std::memory_order_relaxed)) return;
+                b.wait();
+            }
+        };
+        // Blocking pop; false once the producer is done and the ring drained
+        auto pop = [](auto& ring, auto& v, const std::atomic<bool>& done) {
+            pipeline::Backoff b;
+            while (!ring.try_pop(v)) {
+                if (done.load(std::memory_order_acquire) && ring.empty()) return false;
+                b.wait();
+            }
+            return true;
+        };
+
+        std::thread feed([&] {
+            opt.pinned[0] = pin_thread(opt.cpus[0]);
+            for (int i = 1; i <= num_bars && !stop.load(std::memory_order_relaxed); ++i) {
+                uint64_t t0 = latency::now();
+                if (ticks) {
+                    market.next_bar(i, [&](const MarketEvent& ev) {
+                        Event e{ev, latency::now()};
+                        push(*to_strategy, e);
+                        push(*to_exec, e);
+                    });
+                } else {
+                    push(*bars, BarMsg{market.next_bar(i), latency::now()});
+                }
+                lat_.record(latency::FEED, latency::now() - t0);
+                if (slow_mode) std::this_thread::sleep_for(std::chrono::milliseconds(30));
+            }
+            fed.store(true, std::memory_order_release);
+        });
+
+        std::thread strategy([&] {
+            opt.pinned[1] = pin_thread(opt.cpus[1]);
+            auto score = [&](const Bar& bar, uint64_t fed_at) {
+                uint64_t t0 = latency::now();
+                lat_.record(latency::Q_SIGNAL, t0 - fed_at);
+                BarSignal s = evaluate(bar);
+                s.fed = fed_at;
+                s.sent = latency::now();
+                s.scored = s.sent - t0;     // recorded with the rest of the decision by execution
+                push(*signals, s);
+            };
+            Event e;
+            BarMsg m;
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (!ticks) {
+                    if (!pop(*bars, m, fed)) break;
+                    score(m.v, m.t);
+                    continue;
+                }
+                if (!pop(*to_strategy, e, fed)) break;
+                switch (e.v.type) {
+                case MarketEvent::BAR_OPEN:  builder_.open(e.v); break;
+                case MarketEvent::TICK:      builder_.add(e.v); break;
+                case MarketEvent::BAR_CLOSE: score(builder_.close(), e.t); break;
+                }
+            }
+            scored.store(true, std::memory_order_release);
+        });
+
+        // Execution: events in feed order; at each bar close, that bar's signal.
+        // It runs on the caller, whose affinity is put back afterwards so
+        // threads started later (e.g. the --mc pool) are not confined to it.
+        cpu_set_t caller_cpus;
+        CPU_ZERO(&caller_cpus);
+        bool saved = sched_getaffinity(0, sizeof(caller_cpus), &caller_cpus) == 0;
+        opt.pinned[2] = pin_thread(opt.cpus[2]);
+        Event e;
+        BarSignal s;
+        for (;;) {
+            if (ticks) {
+                if (!pop(*to_exec, e, fed)) break;
+                if (journal_) journal_->event(e.v);
+                if (e.v.type == MarketEvent::TICK) on_tick(e.v);
+                if (e.v.type != MarketEvent::BAR_CLOSE) continue;
+            }
+            if (!pop(*signals, s, scored)) break;
+            if (journal_ && !ticks) journal_->bar(s.bar);
+            uint64_t t0 = latency::now();
+            lat_.record(latency::Q_EXEC, t0 - s.sent);
+            StageClock clk(true);
+            clk.charge(latency::SIGNAL, s.scored);
+            bool live = execute(s, clk);
+            lat_.record(latency::BAR_TO_ORDER, latency::now() - s.fed);
+            if (slow_mode) flush_output();
+            if (!live) break;
+        }
+        stop.store(true, std::memory_order_release);
+        feed.join();
+        strategy.join();
+        if (saved) sched_setaffinity(0, sizeof(caller_cpus), &caller_cpus);
+
+        if (pos_side_ != Side::NONE) flatten(market.next_bar(num_bars + 1));
+
+        finish();
+    }
+
+    // Entries also need portfolio->can_trade(); P&L is published to `slot`
+    void set_portfolio(PortfolioRisk* portfolio, size_t slot) {
+        portfolio_ = portfolio;
+        portfolio_slot_ = slot;
+    }
+
+    // Applies configs published to `channel` from the next bar on; the one
+    // current now is taken as already applied (the engine was built from it)
+    void set_config(ConfigChannel* channel) requires (!Strategy::FIXED) {
+        config_ = channel;
+        applied_config_ = channel->current();
+        channel->ack(applied_config_);
+    }
+
+    // Saves a snapshot to `path` every `every` bars and when the breaker trips;
+    // `source` is where this run's bars come from
+    void set_snapshot(const char* path, int every, snapshot::Source source) {
+        snapshot_path_ = path;
+        snapshot_every_ = std::max(1, every);
+        snapshot_source_ = source;
+    }
+
+    bool save_snapshot(const std::string& path, int bar, std::string& err) {
+        snapshot_buf_.clear();
+        snapshot::Writer w(snapshot_buf_);
+        state(w);
+
+        snapshot::Header h{};
+        std::memcpy(h.magic, snapshot::MAGIC, sizeof(h.magic));
+        h.version = snapshot::VERSION;
+        h.source = snapshot_source_;
+        h.payload_size = (uint32_t)snapshot_buf_.size();
+        std::snprintf(h.symbol, sizeof(h.symbol), "%s", spec_.symbol);
+        auto periods = signal_.periods();
+        std::copy(periods.begin(), periods.end(), h.periods);
+        h.bar = bar;
+        h.checksum = snapshot::fnv1a(snapshot_buf_.data(), snapshot_buf_.size());
+
+        std::string tmp = path + ".tmp";
+        std::FILE* f = std::fopen(tmp.c_str(), "wb");
+        if (!f) { err = tmp + ": " + std::strerror(errno); return false; }
+        bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1
+               && std::fwrite(snapshot_buf_.data(), 1, snapshot_buf_.size(), f) == snapshot_buf_.size();
+        ok = std::fclose(f) == 0 && ok;
+        if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+            err = path + ": " + std::strerror(errno);
+            std::remove(tmp.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // Loads a snapshot taken from the same kind of bar source, with the same
+    // symbol and indicator periods; runs then continue from the bar after it.
+    // On failure the engine may be partly overwritten and should not be used.
+    bool restore_snapshot(const char* path, snapshot::Source source, std::string& err) {
+        std::ifstream f(path, std::ios::binary);
+        if (!f) { err = std::string("cannot read ") + path; return false; }
+        snapshot::Header h;
+        if (!f.read(reinterpret_cast<char*>(&h), sizeof(h))) { err = "truncated snapshot header"; return false; }
+        if (std::memcmp(h.magic, snapshot::MAGIC, sizeof(h.magic)) != 0) { err = "not a snapshot (bad magic)"; return false; }
+        if (h.version != snapshot::VERSION) { err = "unsupported snapshot version"; return false; }
+        if (h.source != source) {
+            err = h.source == snapshot::BAR_STORE ? "snapshot was taken replaying a bar store (--data)"
+                                                  : "snapshot was taken on the simulator (no --data)";
+            return false;
+        }
+        if (std::strncmp(h.symbol, spec_.symbol, sizeof(h.symbol)) != 0) {
+            err = std::string("snapshot is for ") + std::string(h.symbol, strnlen(h.symbol, sizeof(h.symbol)));
+            return false;
+        }
+        auto periods = signal_.periods();
+        if (!std::equal(periods.begin(), periods.end(), h.periods)) {
+            err = "snapshot was taken with different indicator periods";
+            return false;
+        }
+        snapshot_buf_.resize(h.payload_size);
+        if (!f.read(snapshot_buf_.data(), h.payload_size)) { err = "truncated snapshot"; return false; }
+        if (snapshot::fnv1a(snapshot_buf_.data(), snapshot_buf_.size()) != h.checksum) {
+            err = "snapshot checksum mismatch";
+            return false;
+        }
+        snapshot::Reader r(snapshot_buf_.data(), snapshot_buf_.size());
+        state(r);
+        if (!r.ok()) { err = "snapshot layout does not match this build"; return false; }
+        totals_ = {};
+        for (const Trade& t : trades_) count_trade(t.pnl);
+        resume_bar_ = h.bar;
+        return true;
+    }
+
+    int resume_bar() const { return resume_bar_; }
+
+    // Headless step over the engine's own simulated market (portfolio shards).
+    // Returns false once this instrument or the portfolio is stopped.
+    bool step(int idx) {
+        quiet_ = true;
+        return on_bar(market_.next_bar(idx));
+    }
+
+    // Flattens an open position at the next simulated bar
+    void close_out(int idx) {
+        if (pos_side_ != Side::NONE) flatten(market_.next_bar(idx));
+    }
+
+    const ContractSpec& spec() const { return spec_; }
+
+    // Console runs log bars/entries/exits through `log` (not owned, started)
+    void set_log(ConsoleLog* log) { log_ = log; }
+
+    // Publishes ticks/bars/signals/positions/fills to `feed` (not owned)
+    void set_feed(ShmFeed* feed) { feed_ = feed; }
+
+    // Streams bars/trades/equity to `s` during console runs (not owned)
+    void set_stream(NdjsonStream* s) { stream_ = s; }
+
+    // Executes through working orders in `om` (not owned); tick-driven runs only
+    void set_orders(OrderManager* om) { orders_ = om; }
+
+    // Journals every input and fill to `j` (not owned)
+    void set_journal(journal::Writer* j) { journal_ = j; }
+
+    // Event pipeline entry point. Returns false once the circuit breaker has
+    // tripped (only evaluated on BAR_CLOSE).
+    bool on_event(const MarketEvent& ev) {
+        if (journal_) journal_->event(ev);
+        switch (ev.type) {
+        case MarketEvent::BAR_OPEN:  builder_.open(ev); return true;
+        case MarketEvent::TICK:
+            builder_.add(ev);
+            on_tick(ev);
+            return true;
+        case MarketEvent::BAR_CLOSE: return on_bar(builder_.close());
+        }
+        return true;
+    }
+
+    // Execution side of a trade print. Stops fill at the triggering trade
+    // (slipping through gaps), targets at the limit price. Entries and
+    // MAX_HOLD stay on bar close.
+    void on_tick(const MarketEvent& ev) {
+        now_ = ev.time;
+        ++ticks_seen_;
+        if (feed_) feed_->publish(QS_TICK, ev.bar, ev.time, 0, 0, px(ev.price), ev.size);
+        if (orders_) {
+            Ticks stop = stop_price_;
+            if (pos_side_ != Side::NONE && update_trail(ev.price)) {
+                if (uint32_t id = orders_->modify(stop_id_, stop_price_)) stop_id_ = id;
+                else stop_price_ = stop;    // still working at the old level; retried next trade
+            }
+            orders_->on_trade(ev.price, ev.size, [&](const Fill& f) { on_fill(ev.bar, f); });
+            return;
+        }
+        if (pos_side_ == Side::NONE) return;
+        if (ExitReason reason = check_stops(ev.price); reason != ExitReason::NONE) {
+            bool target = pos_side_ == Side::LONG ? ev.price >= target_price_ : ev.price <= target_price_;
+            close_position_at(ev.bar, target ? target_price_ : ev.price, reason);
+            tick_exit_ = true;
+        }
+    }
+
+    // Console run over a bar source (`const Bar* next()`, nullptr at end),
+    // e.g. BarReplay over a mapped store. Bars are used in place. The last bar
+    // is held back for the EOD flatten, mirroring run().
+    template <class Source>
+    void replay(Source& src, const char* label, bool slow_mode) {
+        print_header(label);
+        if constexpr (requires { src.remaining(); }) bar_history_.reserve(src.remaining());
+        const Bar* cur = src.next();
+        while (cur && cur->index <= resume_bar_) cur = src.next();
+        if (!cur) { std::printf("  Aucune barre a rejouer.\n"); return; }
+        for (const Bar* nxt;; cur = nxt) {
+            uint64_t t0 = latency::now();
+            nxt = src.next();
+            lat_.record(latency::FEED, latency::now() - t0);
+            if (!nxt || !on_bar(*cur)) break;
+            if (slow_mode) pace();
+        }
+        if (pos_side_ != Side::NONE) flatten(*cur);
+
+        finish();
+    }
+
+    // Headless run over a bar series (sweep mode), same held-back last bar
+    RunStats backtest(const Bar* bars, size_t count) {
+        quiet_ = true;
+        if (count == 0) return stats();
+        size_t n = count - 1;
+        for (size_t i = 0; i < n; ++i)
+            if (!on_bar(bars[i])) break;
+        if (pos_side_ != Side::NONE) flatten(bars[n]);
+        return stats();
+    }
+
+    // Headless tick-driven run over recorded events; an open position is
+    // flattened at the last trade
+    RunStats backtest_events(const MarketEvent* events, size_t count) {
+        quiet_ = true;
+        tick_mode_ = true;
+        for (size_t i = 0; i < count; ++i)
+            if (!on_event(events[i])) break;
+        if (pos_side_ != Side::NONE) flatten(builder_.current());
+        return stats();
+    }
+
+    // Headless replay of a journal's records after its starting CONFIG. The
+    // inputs are fed back in order and `check` (in check mode) compares what
+    // the engine journals again, fills included. A CONFIG record follows the
+    // bar it was applied on, so it is published to `configs` just before it.
+    RunStats replay_journal(journal::Cursor& in, bool tick_mode, ConfigChannel& configs,
+                            journal::Writer& check) {
+        quiet_ = true;
+        tick_mode_ = tick_mode;
+        journal_ = &check;
+        auto stage_config = [&] {
+            if (in.peek() != journal::CONFIG) return;
+            journal::RecordHeader h;
+            const char* p;
+            in.next(h, p);
+            auto rec = journal::payload<journal::ConfigRecord>(p);
+            configs.publish(std::make_unique<LiveConfig>(LiveConfig{journal::from_record(rec), (int)rec.version}));
+        };
+
+        journal::RecordHeader h;
+        const char* p;
+        while (!check.diverged() && in.next(h, p)) {
+            switch (h.type) {
+            case journal::BAR_OPEN:
+            case journal::TICK:
+            case journal::BAR_CLOSE: {
+                auto e = journal::payload<journal::EventRecord>(p);
+                if (h.type == journal::BAR_CLOSE) stage_config();
+                on_event({(MarketEvent::Type)h.type, e.bar, e.time, e.price, e.size});
+                break;
+            }
+            case journal::BAR:
+                stage_config();
+                on_bar(journal::from_record(journal::payload<journal::BarRecord>(p)));
+                break;
+            case journal::FLATTEN:
+                if (pos_side_ != Side::NONE) flatten(journal::from_record(journal::payload<journal::BarRecord>(p)));
+                break;
+            default:
+                break;   // FILL: the engine's own output, checked by `check`
+            }
+        }
+        journal_ = nullptr;
+        return stats();
+    }
+
+    // Processes one bar. Returns false once the circuit breaker has tripped.
+    bool on_bar(const Bar& bar) {
+        StageClock clk(!quiet_);
+        if (journal_ && !tick_mode_) journal_->bar(bar);   // tick runs journal the events
+        BarSignal s = evaluate(bar);
+        clk.lap(latency::SIGNAL);
+        return execute(s, clk);
+    }
+
+    // Strategy stage of a bar: picks up a new config's weights, scores the
+    // bar and takes the indicator values execution and output need. Touches
+    // only signal-side state, so it can run on its own thread.
+    BarSignal evaluate(const Bar& bar) {
+        BarSignal s{};
+        s.bar = bar;
+        if (config_) {
+            if (const LiveConfig* c = config_->poll(applied_config_)) {
+                if constexpr (!Strategy::FIXED) signal_.set_weights(c->params);
+                applied_config_ = c;
+                s.config = c;
+            }
+        }
+        s.sig = signal_.evaluate(bar);
+        s.rsi = signal_.rsi();
+        s.ema9 = signal_.ema9();
+        s.ema21 = signal_.ema21();
+        s.vwap = signal_.vwap_val();
+        s.atr = signal_.atr_val();
+        return s;
+    }
+
+    // Execution stage of a bar: the rest of the config switch, exits, risk,
+    // entries and output. Returns false once the circuit breaker has tripped.
+    bool execute(const BarSignal& s, StageClock& clk) {
+        const Bar& bar = s.bar;
+        const Signal& sig = s.sig;
+        if (s.config) apply_config(*s.config, bar.index);
+
+        // Store bar data for JSON
+        if (!quiet_)
+            bar_history_.push_back({bar.index, bar.close, s.rsi, s.ema9, s.ema21, s.vwap, s.atr});
+        if (stream_)
+            stream_->bar(bar.index, px(bar.close), s.rsi, px(s.ema9), px(s.ema21), px(s.vwap), px(s.atr));
+
+        // Print bar info every 10 bars (or on signal/trade)
+        bool has_signal = sig.action != TradeAction::NONE;
+        now_ = bar.time;
+        if (feed_) {
+            feed_->publish(QS_BAR, bar.index, bar.time, 0, 0, px(bar.open), px(bar.high), px(bar.low), px(bar.close), bar.volume);
+            if (has_signal)
+                feed_->publish(QS_SIGNAL, bar.index, bar.time, sig.action == TradeAction::BUY ? 1 : -1,
+                    (uint16_t)sig.reasons, sig.score);
+        }
+        clk.lap(latency::OUTPUT);
+        bool has_exit = tick_exit_;
+        tick_exit_ = false;
+
+        // Check position management first
+        if (pos_side_ != Side::NONE) {
+            ExitReason reason = tick_mode_ ? check_max_hold(bar) : check_exit(bar);
+            if (reason != ExitReason::NONE) {
+                has_exit = true;
+                close_position(bar, reason);
+            }
+        }
+        clk.lap(latency::EXEC);
+
+        // Log bar
+        if (log_ && (bar.index % 10 == 0 || has_signal || has_exit || bar.index <= 5)) {
+            LogRecord r{};
+            r.type = LogRecord::BAR;
+            r.action = sig.action;
+            r.bar = bar.index;
+            r.price = px(bar.close);
+            r.rsi = s.rsi;
+            r.ema9 = px(s.ema9);
+            r.ema21 = px(s.ema21);
+            r.vwap = px(s.vwap);
+            r.atr = px(s.atr);
+            log_->push(r);
+        }
+
+        // Log exit
+        if (log_ && has_exit) {
+            const auto& t = trades_.back();
+            LogRecord r{};
+            r.type = LogRecord::EXIT;
+            r.side = t.side;
+            r.exit = t.exit_reason;
+            r.bar = t.exit_bar;
+            r.price = px(t.exit_price);
+            r.pnl = t.pnl;
+            log_->push(r);
+        }
+        clk.lap(latency::OUTPUT);
+
+        // Try to enter new position
+        bool enter = false;
+        if (pos_side_ == Side::NONE && !entry_id_ && has_signal) {
+            enter = risk_.can_trade() && (!portfolio_ || portfolio_->can_trade());
+            clk.lap(latency::RISK);
+        }
+        if (enter) {
+            open_position(bar, sig, s.atr);
+            clk.lap(latency::EXEC);
+            if (pos_side_ != Side::NONE) log_entry(sig, bar.index);   // else on the fill
+            clk.lap(latency::OUTPUT);
+        }
+        lat_.record(clk);
+
+        // Check circuit breaker
+        if (risk_.is_killed() || (portfolio_ && portfolio_->is_killed())) {
+            if (snapshot_every_) write_snapshot(bar.index);
+            if (log_) {
+                LogRecord r{};
+                r.type = LogRecord::BREAKER;
+                r.bar = bar.index;
+                log_->push(r);
+            }
+            return false;
+        }
+
+        // Track drawdown
+        double pnl = risk_.daily_pnl();
+        if (pnl > peak_pnl_) peak_pnl_ = pnl;
+        double dd = pnl - peak_pnl_;
+        if (dd < max_drawdown_) max_drawdown_ = dd;
+
+        // Equity curve point on each trade
+        if (has_exit) {
+            equity_curve_.push_back({bar.index, risk_.daily_pnl()});
+            if (stream_) {
+                stream_->equity(bar.index, risk_.daily_pnl());
+                stream_->stats(stats());
+            }
+        }
+        if (snapshot_every_ && bar.index % snapshot_every_ == 0) write_snapshot(bar.index);
+        return true;
+    }
+
+    void flatten(const Bar& last) {
+        if (journal_) journal_->flatten(last);
+        close_position(last, ExitReason::EOD_FLATTEN);
+        if (log_) {
+            LogRecord r{};
+            r.type = LogRecord::FLATTEN;
+            r.bar = last.index;
+            r.price = px(last.close);
+            log_->push(r);
+        }
+    }
+
+    uint64_t ticks_seen() const { return ticks_seen_; }
+    const std::vector<Trade>& trades() const { return trades_; }
+    const RiskManager& risk() const { return risk_; }
+
+    // O(1): the per-trade --stream stats record reads this on every close
+    RunStats stats() const {
+        RunStats s = totals_;
+        s.trades = (int)trades_.size();
+        s.net = s.gross_profit + s.gross_loss;
+        s.profit_factor = std::abs(s.gross_loss) > 0 ? s.gross_profit / std::abs(s.gross_loss)
+                        : (s.gross_profit > 0 ? 999 : 0);
+        s.max_drawdown = max_drawdown_;
+        s.expectancy = s.trades > 0 ? s.net / s.trades : 0;
+        return s;
+    }
+
+    void export_json(const char* path) {
+        std::ofstream f(path);
+        if (!f) return;
+        write_json(f);
+        f.close();
+        std::printf("  %sJSON exported:%s results.json\n", clr::CYAN, clr::RESET);
+    }
+
+    void write_json(std::ostream& f) {
+        // Stats
+        int wins = 0, losses = 0;
+        double gross_profit = 0, gross_loss = 0;
+        for (const auto& t : trades_) {
+            if (t.pnl >= 0) { ++wins; gross_profit += t.pnl; }
+            else { ++losses; gross_loss += t.pnl; }
+        }
+        int total = (int)trades_.size();
+        double net = gross_profit + gross_loss;
+        double win_rate = total > 0 ? 100.0 * wins / total : 0;
+        double pf = std::abs(gross_loss) > 0 ? gross_profit / std::abs(gross_loss) : 0;
+
+        f << "{\n";
+        // Stats
+        f << "\"stats\":{";
+        f << "\"trades\":" << total << ",\"wins\":" << wins << ",\"losses\":" << losses;
+        f << ",\"win_rate\":" << std::fixed;
+        f.precision(1); f << win_rate;
+        f << ",\"net_pnl\":"; f.precision(2); f << net;
+        f << ",\"gross_profit\":" << gross_profit;
+        f << ",\"gross_loss\":" << gross_loss;
+        f << ",\"profit_factor\":"; f.precision(2); f << pf;
+        f << ",\"max_drawdown\":" << max_drawdown_;
+        f << ",\"expectancy\":"; f << (total > 0 ? net / total : 0.0);
+        f << "},\n";
+
+        // Per-stage latency, ns
+#if QUADSCALP_LATENCY
+        {
+            double k = lat_.ns_per_tick();
+            f << "\"latency\":{";
+            f.precision(0);
+            for (int i = 0; i < latency::NUM_STAGES; ++i) {
+                const auto& h = lat_[latency::Stage(i)];
+                if (i > 0) f << ",";
+                f << "\"" << latency::STAGE_NAMES[i] << "\":{\"count\":" << h.count()
+                  << ",\"p50\":" << h.percentile(0.50) * k << ",\"p99\":" << h.percentile(0.99) * k
+                  << ",\"p999\":" << h.percentile(0.999) * k << ",\"max\":" << h.max() * k << "}";
+            }
+            f << "},\n";
+            f.precision(2);
+        }
+#endif
+
+        // Trades
+        f << "\"trades\":[";
+        for (size_t i = 0; i < trades_.size(); ++i) {
+            const auto& t = trades_[i];
+            if (i > 0) f << ",";
+            f << "\n{\"entry_bar\":" << t.entry_bar;
+            f << ",\"exit_bar\":" << t.exit_bar;
+            f << ",\"side\":\"" << (t.side == Side::LONG ? "LONG" : "SHORT") << "\"";
+            f << ",\"entry\":" << px(t.entry_price);
+            f << ",\"exit\":" << px(t.exit_price);
+            f << ",\"pnl\":" << t.pnl;
+            f << ",\"reason\":\"" << exit_reason_name(t.exit_reason) << "\"}";
+        }
+        f << "\n],\n";
+
+        // Equity curve
+        f << "\"equity\":[";
+        for (size_t i = 0; i < equity_curve_.size(); ++i) {
+            if (i > 0) f << ",";
+            f << "[" << equity_curve_[i].bar << "," << equity_curve_[i].pnl << "]";
+        }
+        f << "],\n";
+
+        // Price data (sample every 5 bars for chart)
+        f << "\"bars\":[";
+        bool first = true;
+        for (size_t i = 0; i < bar_history_.size(); i += 3) {
+            const auto& b = bar_history_[i];
+            if (!first) f << ",";
+            first = false;
+            f << "\n[" << b.idx << "," << px(b.close) << "," << b.rsi << ","
+              << px(b.ema9) << "," << px(b.ema21) << "," << px(b.vwap) << "," << px(b.atr) << "]";
+        }
+        f << "\n]\n}\n";
+    }
+
+private:
+    // Everything a warm restart needs, in file order (see snapshot::Header)
+    template <class Ar>
+    void state(Ar& ar) {
+        signal_.state(ar);
+        risk_.state(ar);
+        market_.state(ar);
+        ar(pos_side_, entry_price_, entry_bar_, stop_price_, target_price_, max_favorable_,
+           peak_pnl_, max_drawdown_, trades_, equity_curve_);
+    }
+
+    void write_snapshot(int bar_index) {
+        std::string err;
+        if (!save_snapshot(snapshot_path_, bar_index, err))
+            std::fprintf(stderr, "snapshot: %s\n", err.c_str());
+    }
+
+    // Exits and risk limits switch over here (weights already did, in
+    // evaluate()); an open position keeps the stop and target it was entered
+    // with. Acking from the execution side keeps `c` alive until both stages
+    // are done with it.
+    void apply_config(const LiveConfig& c, int bar_index) {
+        risk_.set_limits(c.params.max_daily_loss, c.params.max_trade_loss, c.params.max_trades);
+        stop_atr_ = c.params.stop_atr;
+        target_atr_ = c.params.target_atr;
+        trailing_pct_ = c.params.trailing_pct;
+        config_->ack(&c);
+        if (journal_) journal_->config(c);
+
+        if (log_) {
+            LogRecord r{};
+            r.type = LogRecord::CONFIG;
+            r.bar = bar_index;
+            r.reasons = (uint32_t)c.version;
+            log_->push(r);
+        }
+        if (stream_) stream_->config(c.version, bar_index);
+    }
+
+    // Ticks -> points, for output only
+    double px(double ticks) const { return ticks * spec_.tick_size; }
+
+    void open_position(const Bar& bar, const Signal& sig, double atr) {   // atr in ticks
+        if (atr < 1) atr = 8; // fallback
+
+        if (orders_) {
+            entry_id_ = orders_->submit_market(sig.action == TradeAction::BUY ? 1 : -1, 1);
+            pending_ = sig;
+            pending_atr_ = atr;
+            return;
+        }
+        enter(sig, bar.index, bar.close, atr);
+    }
+
+    // Position opened at `price`: stop/target from the ATR at the signal
+    void enter(const Signal& sig, int bar_index, Ticks price, double atr) {
+        entry_price_ = price;
+        entry_bar_ = bar_index;
+        max_favorable_ = 0;
+
+        // Levels round to the nearest tick
+        if (sig.action == TradeAction::BUY) {
+            pos_side_ = Side::LONG;
+            stop_price_   = (Ticks)std::lround(entry_price_ - stop_atr_ * atr);    // Tighter stop
+            target_price_ = (Ticks)std::lround(entry_price_ + target_atr_ * atr);  // 1:2 R:R
+        } else {
+            pos_side_ = Side::SHORT;
+            stop_price_   = (Ticks)std::lround(entry_price_ + stop_atr_ * atr);
+            target_price_ = (Ticks)std::lround(entry_price_ - target_atr_ * atr);
+        }
+
+        if (journal_)
+            journal_->fill(bar_index, now_, pos_side_ == Side::LONG ? 1 : -1, ExitReason::NONE, entry_price_, 1, 0);
+        if (feed_) {
+            int8_t side = pos_side_ == Side::LONG ? 1 : -1;
+            feed_->publish(QS_FILL, bar_index, now_, side, 0, px(entry_price_), 1);
+            feed_->publish(QS_POSITION, bar_index, now_, side, 0, px(entry_price_), px(stop_price_), px(target_price_), 1);
+        }
+
+        if (orders_) {
+            bool is_long = pos_side_ == Side::LONG;
+            stop_id_ = orders_->submit(is_long ? OrderManager::SELL_STOP : OrderManager::BUY_STOP, stop_price_, 1);
+            target_id_ = orders_->submit(is_long ? OrderManager::SELL_LIMIT : OrderManager::BUY_LIMIT, target_price_, 1);
+            if (stop_id_ && target_id_) {
+                orders_->link_oco(stop_id_, target_id_);
+                return;
+            }
+            // A leg was refused (pool full, level outside the window): no
+            // unprotected position, flatten at market as a stop-out
+            orders_->cancel(stop_id_);
+            orders_->cancel(target_id_);
+            stop_id_ = target_id_ = 0;
+            close_position_at(bar_index, price + (is_long ? -orders_->slippage() : orders_->slippage()),
+                ExitReason::STOP_LOSS);
+            tick_exit_ = true;
+        }
+    }
+
+    void log_entry(const Signal& sig, int bar_index) {
+        if (!log_) return;
+        LogRecord r{};
+        r.type = LogRecord::ENTRY;
+        r.action = sig.action;
+        r.reasons = sig.reasons;
+        r.bar = bar_index;
+        r.price = px(entry_price_);
+        r.stop = px(stop_price_);
+        r.target = px(target_price_);
+        r.score = sig.score;
+        log_->push(r);
+    }
+
+    // Working-order fills: the entry opens the position and its bracket,
+    // a bracket leg closes it (the OCO has already cancelled the other)
+    void on_fill(int bar_index, const Fill& f) {
+        if (f.id == entry_id_) {
+            entry_id_ = 0;
+            enter(pending_, bar_index, f.price, pending_atr_);
+            log_entry(pending_, bar_index);
+        } else if (f.done && (f.id == stop_id_ || f.id == target_id_)) {
+            ExitReason reason = f.id == target_id_ ? ExitReason::TAKE_PROFIT
+                              : max_favorable_ > 6 ? ExitReason::TRAILING_STOP : ExitReason::STOP_LOSS;
+            stop_id_ = target_id_ = 0;
+            close_position_at(bar_index, f.price, reason);
+            tick_exit_ = true;
+        }
+    }
+
+    ExitReason check_exit(const Bar& bar) {
+        ExitReason reason = check_stops(bar.close);
+        return reason != ExitReason::NONE ? reason : check_max_hold(bar);
+    }
+
+    ExitReason check_max_hold(const Bar& bar) {
+        // Max hold: 50 bars (~4 min)
+        if (bar.index - entry_bar_ > 50) return ExitReason::MAX_HOLD;
+        return ExitReason::NONE;
+    }
 
-            if (slow_mode) std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    // Updates the trail and tests stop/target at `current`
+    ExitReason check_stops(Ticks current) {
+        bool is_long = pos_side_ == Side::LONG;
+        update_trail(current);
+
+        // Stop hit
+        ExitReason stop = max_favorable_ > 6 ? ExitReason::TRAILING_STOP : ExitReason::STOP_LOSS;
+        if (is_long && current <= stop_price_) return stop;
+        if (!is_long && current >= stop_price_) return stop;
+
+        // Target hit
+        if (is_long && current >= target_price_) return ExitReason::TAKE_PROFIT;
+        if (!is_long && current <= target_price_) return ExitReason::TAKE_PROFIT;
+
+        return ExitReason::NONE;
+    }
+
+    // Tracks the favourable excursion at `current`; true if the stop moved.
+    // Trailing stop: if gained > 8 ticks, trail at 50%. The kept share
+    // rounds toward entry, which triggers on the same trades as the
+    // fractional level would.
+    bool update_trail(Ticks current) {
+        bool is_long = pos_side_ == Side::LONG;
+        Ticks pnl_ticks = is_long ? current - entry_price_ : entry_price_ - current;
+        if (pnl_ticks > max_favorable_) max_favorable_ = pnl_ticks;
+        if (max_favorable_ <= 8) return false;
+
+        Ticks keep = (Ticks)std::floor(max_favorable_ * trailing_pct_);
+        Ticks trail = is_long ? entry_price_ + keep : entry_price_ - keep;
+        if (is_long ? trail <= stop_price_ : trail >= stop_price_) return false;
+        stop_price_ = trail;
+        return true;
+    }
+
+    // Exits decided at bar close (MAX_HOLD, EOD flatten, bar-mode stops); with
+    // working orders the bracket is pulled and a market order fills at the
+    // close, `slippage` ticks worse
+    void close_position(const Bar& bar, ExitReason reason) {
+        Ticks price = bar.close;
+        if (orders_) {
+            orders_->cancel(stop_id_);
+            orders_->cancel(target_id_);
+            stop_id_ = target_id_ = 0;
+            price += pos_side_ == Side::LONG ? -orders_->slippage() : orders_->slippage();
         }
+        close_position_at(bar.index, price, reason);
+    }
 
-        // Flatten if still in position
-        if (pos_side_ != Side::NONE) {
-            Bar last = market_.next_bar(num_bars + 1);
-            close_position(last, "EOD_FLATTEN");
-            std::printf("  %s>>> FLATTEN EOD @ %.2f%s\n", clr::YELLOW, last.close, clr::RESET);
+    void count_trade(double pnl) {
+        if (pnl >= 0) { ++totals_.wins; totals_.gross_profit += pnl; }
+        else { ++totals_.losses; totals_.gross_loss += pnl; }
+    }
+
+    void close_position_at(int bar_index, Ticks price, ExitReason reason) {
+        Ticks pnl_ticks = pos_side_ == Side::LONG
+            ? price - entry_price_
+            : entry_price_ - price;
+        double pnl_dollars = pnl_ticks * spec_.tick_value;
+
+        // Subtract commission (round trip)
+        pnl_dollars -= spec_.commission;
+
+        trades_.push_back({entry_bar_, bar_index, pos_side_, entry_price_, price, pnl_dollars, reason});
+        count_trade(pnl_dollars);
+        if (stream_) stream_->trade(trades_.back(), spec_.tick_size);
+        if (journal_)
+            journal_->fill(bar_index, now_, pos_side_ == Side::LONG ? -1 : 1, reason, price, 1, pnl_dollars);
+        if (feed_) {
+            int8_t side = pos_side_ == Side::LONG ? -1 : 1;   // closing order
+            feed_->publish(QS_FILL, bar_index, now_, side, (uint16_t)reason, px(price), 1, pnl_dollars);
+            feed_->publish(QS_POSITION, bar_index, now_, 0, 0);
+        }
+        risk_.record(pnl_dollars);
+        if (portfolio_) portfolio_->record(portfolio_slot_, pnl_dollars);
+        pos_side_ = Side::NONE;
+    }
+
+    void flush_output() {
+        if (stream_) stream_->flush();
+        if (journal_) journal_->flush();
+    }
+
+    // --slow: stream what we have, then wait for the next bar
+    void pace() {
+        flush_output();
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    }
+
+    // End of a console run
+    void finish() {
+        if (log_) {
+            log_->drain();
+            if (log_->dropped())
+                std::printf("\n  %sConsole:%s %llu log lines dropped (console slower than the run)\n",
+                    clr::YELLOW, clr::RESET, (unsigned long long)log_->dropped());
+        }
+        print_results();
+        print_latency();
+        export_json("results.json");
+        if (stream_) {
+            stream_->stats(stats());
+            stream_->flush();
+        }
+    }
+
+    void print_header(const char* instrument) {
+        std::printf("\n%s", clr::BOLD);
+        std::printf("  ____                  _____           __\n");
+        std::printf(" / __ \\__  ______ _____/ / __/_______ _/ /___\n");
+        std::printf("/ / / / / / / __ `/ __  /\\__ \\/ ___/ __  / __ \\\n");
+        std::printf("/ /_/ / /_/ / /_/ / /_/ /___/ / /__/ /_/ / /_/ /\n");
+        std::printf("\\___\\_\\__,_/\\__,_/\\__,_//____/\\___/\\__,_/ .___/\n");
+        std::printf("                                       /_/\n");
+        std::printf("%s\n", clr::RESET);
+        std::printf("  %sInstrument:%s %s  %sBars:%s 5sec  %sMode:%s Paper\n",
+            clr::CYAN, clr::RESET, instrument, clr::CYAN, clr::RESET, clr::CYAN, clr::RESET);
+        std::printf("  %sRisk:%s Max loss $500/day | Stop 2xATR | Target 3xATR | Trail 50%%\n\n",
+            clr::CYAN, clr::RESET);
+        std::printf("  %s%-6s %10s %7s %9s %9s %9s %9s%s\n",
+            clr::DIM, "Bar", "Price", "RSI", "EMA9", "EMA21", "VWAP", "ATR", clr::RESET);
+        std::printf("  %s──────────────────────────────────────────────────────────────────%s\n",
+            clr::DIM, clr::RESET);
+    }
+
+    void print_latency() {
+#if QUADSCALP_LATENCY
+        {
+            double k = lat_.ns_per_tick();
+            std::printf("  %sLatency (ns)      count      p50      p99    p99.9      max%s\n", clr::CYAN, clr::RESET);
+            for (int i = 0; i < latency::NUM_STAGES; ++i) {
+                const auto& h = lat_[latency::Stage(i)];
+                if (h.count() == 0 && i > latency::DECISION) continue;   // --pipeline only
+                if (h.count() == 0) {
+                    std::printf("  %-12s %10s %8s %8s %8s %8s\n", latency::STAGE_NAMES[i], "-", "-", "-", "-", "-");
+                    continue;
+                }
+                std::printf("  %-12s %10llu %8.0f %8.0f %8.0f %8.0f\n", latency::STAGE_NAMES[i],
+                    (unsigned long long)h.count(), h.percentile(0.50) * k, h.percentile(0.99) * k,
+                    h.percentile(0.999) * k, h.max() * k);
+            }
+            std::printf("\n");
+        }
+#endif
+    }
+
+    void print_results() {
+        std::printf("\n  %s══════════════════════════════════════════════════════════════════%s\n", clr::BOLD, clr::RESET);
+        std::printf("  %s                    RESULTATS DE SIMULATION%s\n", clr::BOLD, clr::RESET);
+        std::printf("  %s══════════════════════════════════════════════════════════════════%s\n\n", clr::BOLD, clr::RESET);
+
+        if (trades_.empty()) {
+            std::printf("  Aucun trade execute.\n");
+            return;
+        }
+
+        int wins = 0, losses = 0;
+        double gross_profit = 0, gross_loss = 0;
+        double best_trade = -1e9, worst_trade = 1e9;
+        int stops = 0, targets = 0, trails = 0, max_holds = 0;
+
+        for (const auto& t : trades_) {
+            if (t.pnl >= 0) { ++wins; gross_profit += t.pnl; }
+            else { ++losses; gross_loss += t.pnl; }
+            best_trade = std::max(best_trade, t.pnl);
+            worst_trade = std::min(worst_trade, t.pnl);
+            switch (t.exit_reason) {
+            case ExitReason::STOP_LOSS:     ++stops; break;
+            case ExitReason::TAKE_PROFIT:   ++targets; break;
+            case ExitReason::TRAILING_STOP: ++trails; break;
+            case ExitReason::MAX_HOLD:      ++max_holds; break;
+            default: break;
+            }
+        }
+
+        int total = (int)trades_.size();
+        double net = gross_profit + gross_loss;
+        double win_rate = total > 0 ? 100.0 * wins / total : 0;
+        double avg_win = wins > 0 ? gross_profit / wins : 0;
+        double avg_loss = losses > 0 ? gross_loss / losses : 0;
+        double pf = std::abs(gross_loss) > 0 ? gross_profit / std::abs(gross_loss) : 999;
+        double expectancy = total > 0 ? net / total : 0;
+
+        const char* net_c = net >= 0 ? clr::GREEN : clr::RED;
+
+        std::printf("  %sTrades:%s       %d total | %s%d wins%s | %s%d losses%s\n",
+            clr::CYAN, clr::RESET, total,
+            clr::GREEN, wins, clr::RESET,
+            clr::RED, losses, clr::RESET);
+        std::printf("  %sWin Rate:%s     %.1f%%\n", clr::CYAN, clr::RESET, win_rate);
+        std::printf("\n");
+        std::printf("  %sGross Profit:%s %s$%.2f%s\n", clr::CYAN, clr::RESET, clr::GREEN, gross_profit, clr::RESET);
+        std::printf("  %sGross Loss:%s   %s$%.2f%s\n", clr::CYAN, clr::RESET, clr::RED, gross_loss, clr::RESET);
+        std::printf("  %s────────────────────────────────%s\n", clr::DIM, clr::RESET);
+        std::printf("  %sNet P&L:%s      %s%s$%.2f%s\n",
+            clr::BOLD, clr::RESET, clr::BOLD, net_c, net, clr::RESET);
+        std::printf("\n");
+        std::printf("  %sProfit Factor:%s %.2f\n", clr::CYAN, clr::RESET, pf);
+        std::printf("  %sExpectancy:%s   $%.2f / trade\n", clr::CYAN, clr::RESET, expectancy);
+        std::printf("  %sMax Drawdown:%s %s$%.2f%s\n", clr::CYAN, clr::RESET, clr::RED, max_drawdown_, clr::RESET);
+        std::printf("\n");
+        std::printf("  %sAvg Win:%s      $%.2f\n", clr::CYAN, clr::RESET, avg_win);
+        std::printf("  %sAvg Loss:%s     $%.2f\n", clr::CYAN, clr::RESET, avg_loss);
+        std::printf("  %sBest Trade:%s   %s$%.2f%s\n", clr::CYAN, clr::RESET, clr::GREEN, best_trade, clr::RESET);
+        std::printf("  %sWorst Trade:%s  %s$%.2f%s\n", clr::CYAN, clr::RESET, clr::RED, worst_trade, clr::RESET);
+        std::printf("\n");
+        std::printf("  %sExit Types:%s   Stop: %d | Target: %d | Trail: %d | MaxHold: %d\n",
+            clr::CYAN, clr::RESET, stops, targets, trails, max_holds);
+
+        std::printf("\n  %s══════════════════════════════════════════════════════════════════%s\n", clr::BOLD, clr::RESET);
+
+        // Verdict
+        if (net > 0 && pf > 1.2 && win_rate > 45) {
+            std::printf("  %s%s  STRATEGIE VIABLE — Pret pour Phase 2 (IB Gateway + CME)%s\n",
+                clr::BOLD, clr::GREEN, clr::RESET);
+        } else if (net > 0) {
+            std::printf("  %s%s  STRATEGIE OK — Optimisation des parametres recommandee%s\n",
+                clr::BOLD, clr::YELLOW, clr::RESET);
+        } else {
+            std::printf("  %s%s  STRATEGIE A REVOIR — Ajuster les indicateurs/risk%s\n",
+                clr::BOLD, clr::RED, clr::RESET);
+        }
+        std::printf("\n");
+    }
+};
+
+using TradingEngine = BasicTradingEngine<>;
+
+// ── Work-Stealing Thread Pool ───────────────────────────────────────────────
+// Each worker owns a deque of index ranges: it pops its own work LIFO from the
+// back and, once empty, steals FIFO from the front of the other workers.
+class ThreadPool {
+    struct Range { size_t begin, end; };
+    struct alignas(64) WorkQueue {
+        std::mutex        m;
+        std::deque<Range> q;
+    };
+
+    size_t n_workers_;
+    std::unique_ptr<WorkQueue[]> queues_;
+    std::vector<std::thread> threads_;
+    std::function<void(size_t, size_t)> task_;
+
+    std::mutex m_;
+    std::condition_variable wake_, done_;
+    uint64_t epoch_ = 0;
+    size_t   busy_ = 0;
+    bool     stop_ = false;
+
+public:
+    explicit ThreadPool(unsigned n = std::thread::hardware_concurrency())
+        : n_workers_(n ? n : 1), queues_(std::make_unique<WorkQueue[]>(n_workers_)) {
+        for (size_t w = 0; w < n_workers_; ++w)
+            threads_.emplace_back([this, w] { worker(w); });
+    }
+    ~ThreadPool() {
+        { std::lock_guard<std::mutex> lk(m_); stop_ = true; }
+        wake_.notify_all();
+        for (auto& t : threads_) t.join();
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return n_workers_; }
+
+    // Runs f(i) for i in [0, n) and blocks until every index is done.
+    template <class F>
+    void parallel_for(size_t n, F&& f, size_t grain = 0) {
+        if (n == 0) return;
+        if (grain == 0) grain = std::max<size_t>(1, n / (n_workers_ * 8));
+
+        // Deal chunks round-robin so every worker starts on local work
+        size_t w = 0;
+        for (size_t b = 0; b < n; b += grain, w = (w + 1) % n_workers_) {
+            std::lock_guard<std::mutex> lk(queues_[w].m);
+            queues_[w].q.push_back({b, std::min(n, b + grain)});
+        }
+
+        std::unique_lock<std::mutex> lk(m_);
+        task_ = [&f](size_t b, size_t e) { for (size_t i = b; i < e; ++i) f(i); };
+        busy_ = n_workers_;
+        ++epoch_;
+        wake_.notify_all();
+        done_.wait(lk, [this] { return busy_ == 0; });
+        task_ = nullptr;
+    }
+
+private:
+    bool next(size_t w, Range& r) {
+        {
+            auto& own = queues_[w];
+            std::lock_guard<std::mutex> lk(own.m);
+            if (!own.q.empty()) { r = own.q.back(); own.q.pop_back(); return true; }
+        }
+        for (size_t k = 1; k < n_workers_; ++k) {
+            auto& victim = queues_[(w + k) % n_workers_];
+            std::lock_guard<std::mutex> lk(victim.m);
+            if (!victim.q.empty()) { r = victim.q.front(); victim.q.pop_front(); return true; }
+        }
+        return false;
+    }
+
+    void worker(size_t w) {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lk(m_);
+                wake_.wait(lk, [&] { return stop_ || epoch_ != seen; });
+                if (stop_) return;
+                seen = epoch_;
+            }
+            Range r;
+            while (next(w, r)) task_(r.begin, r.end);
+
+            std::lock_guard<std::mutex> lk(m_);
+            if (--busy_ == 0) done_.notify_one();
+        }
+    }
+};
+
+// ── Parameter Sweep ─────────────────────────────────────────────────────────
+// Grid axes are given as key=v1,v2,... or key=start:stop:step. Combinations
+// are decoded from a flat index (mixed radix), so the grid is never
+// materialised and every worker can build its own StrategyParams.
+
+// Whole string as a number; false on anything else
+inline bool parse_number(const std::string& s, double& v) {
+    char* end = nullptr;
+    v = std::strtod(s.c_str(), &end);
+    return !s.empty() && *end == '\0';
+}
+
+// Values as v1,v2,... or lo:hi[:step] (step defaults to 1)
+inline bool parse_values(const std::string& list, std::vector<double>& out) {
+    size_t c1 = list.find(':');
+    if (c1 != std::string::npos) {
+        size_t c2 = list.find(':', c1 + 1);
+        double lo, hi, step = 1.0;
+        if (!parse_number(list.substr(0, c1), lo)
+            || !parse_number(list.substr(c1 + 1, c2 == std::string::npos ? std::string::npos : c2 - c1 - 1), hi)
+            || (c2 != std::string::npos && !parse_number(list.substr(c2 + 1), step)))
+            return false;
+        if (!(step > 0)) return false;
+        for (int k = 0; lo + k * step <= hi + 1e-9; ++k) out.push_back(lo + k * step);
+    } else {
+        size_t pos = 0;
+        while (pos <= list.size()) {
+            size_t comma = list.find(',', pos);
+            if (comma == std::string::npos) comma = list.size();
+            double v;
+            if (comma > pos) {
+                if (!parse_number(list.substr(pos, comma - pos), v)) return false;
+                out.push_back(v);
+            }
+            pos = comma + 1;
+        }
+    }
+    return !out.empty();
+}
+
+class ParamGrid {
+    struct Axis { std::string key; std::vector<double> values; };
+    std::vector<Axis> axes_;
+    StrategyParams base_;
+
+public:
+    // Parses one axis spec; returns false on an unknown key, a malformed or
+    // empty axis, or a value the key does not accept.
+    bool add(const std::string& spec) {
+        size_t eq = spec.find('=');
+        if (eq == std::string::npos) return false;
+        Axis a{spec.substr(0, eq), {}};
+        if (!parse_values(spec.substr(eq + 1), a.values)) return false;
+        StrategyParams probe;
+        for (double v : a.values)
+            if (!set_param(probe, a.key, v)) return false;
+        axes_.push_back(std::move(a));
+        return true;
+    }
+
+    bool empty() const { return axes_.empty(); }
+    size_t num_axes() const { return axes_.size(); }
+    const std::string& key(size_t a) const { return axes_[a].key; }
+
+    size_t size() const {
+        size_t n = 1;
+        for (const auto& a : axes_) n *= a.values.size();
+        return n;
+    }
+
+    // Value of axis `a` in combination `idx` (last axis varies fastest)
+    double value(size_t idx, size_t a) const {
+        for (size_t k = axes_.size() - 1; k > a; --k) idx /= axes_[k].values.size();
+        return axes_[a].values[idx % axes_[a].values.size()];
+    }
+
+    StrategyParams at(size_t idx) const {
+        StrategyParams p = base_;
+        for (size_t k = axes_.size(); k-- > 0;) {
+            const auto& v = axes_[k].values;
+            set_param(p, axes_[k].key, v[idx % v.size()]);
+            idx /= v.size();
+        }
+        return p;
+    }
+};
+
+struct SweepResult {
+    size_t   combo;
+    RunStats stats;
+};
+
+// `bars` is one shared, read-only series (simulated or a mapped store) in
+// ticks of `spec`; its last bar is the EOD flatten bar.
+inline void run_sweep(const ParamGrid& grid, const Bar* bars, size_t count, unsigned threads,
+                      size_t top, const std::string& rank, const ContractSpec& spec = CONTRACTS[0]) {
+    int num_bars = count > 0 ? (int)count - 1 : 0;
+    size_t n = grid.size();
+    std::vector<SweepResult> results(n);
+    ThreadPool pool(threads);
+
+    std::printf("\n  %sParameter sweep:%s %zu combinations x %d bars on %zu threads\n",
+        clr::CYAN, clr::RESET, n, num_bars, pool.size());
+
+    auto t0 = std::chrono::steady_clock::now();
+    pool.parallel_for(n, [&](size_t i) {
+        TradingEngine engine(grid.at(i), spec);
+        results[i] = {i, engine.backtest(bars, count)};
+    });
+    auto t1 = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+    auto key = [&](const RunStats& s) {
+        if (rank == "pf")         return s.profit_factor;
+        if (rank == "dd")         return s.max_drawdown;   // closest to zero first
+        if (rank == "expectancy") return s.expectancy;
+        return s.net;
+    };
+    std::sort(results.begin(), results.end(), [&](const SweepResult& a, const SweepResult& b) {
+        double ka = key(a.stats), kb = key(b.stats);
+        return ka != kb ? ka > kb : a.combo < b.combo;
+    });
+
+    std::printf("  %sRanked by:%s %s\n\n", clr::CYAN, clr::RESET, rank.c_str());
+    std::printf("  %s%5s %10s %6s %10s %9s %6s %6s", clr::DIM,
+        "#", "Net P&L", "PF", "MaxDD", "Expect", "Trades", "Win%");
+    for (size_t a = 0; a < grid.num_axes(); ++a) std::printf(" %9s", grid.key(a).c_str());
+    std::printf("%s\n", clr::RESET);
+
+    size_t shown = std::min(top, n);
+    for (size_t r = 0; r < shown; ++r) {
+        const auto& s = results[r].stats;
+        double win_rate = s.trades > 0 ? 100.0 * s.wins / s.trades : 0;
+        std::printf("  %5zu %s%10.2f%s %6.2f %10.2f %9.2f %6d %6.1f",
+            r + 1, s.net >= 0 ? clr::GREEN : clr::RED, s.net, clr::RESET,
+            s.profit_factor, s.max_drawdown, s.expectancy, s.trades, win_rate);
+        for (size_t a = 0; a < grid.num_axes(); ++a)
+            std::printf(" %9g", grid.value(results[r].combo, a));
+        std::printf("\n");
+    }
+
+    double bar_evals = (double)n * num_bars;
+    std::printf("\n  %sSweep:%s %.1f ms (%.0f combos/sec, %.2fM bars/sec)\n\n",
+        clr::DIM, clr::RESET, ms, n / (ms / 1000.0), bar_evals / (ms * 1000.0));
+}
+
+// ── Portfolio (multi-instrument, sharded across pinned threads) ─────────────
+// Instruments are dealt round-robin to `shards` threads, each pinned to one
+// of the process's allowed CPUs (round-robin too). A shard owns its engines
+// (signal, per-instrument risk, simulated market) and steps them bar by bar;
+// the only shared state is PortfolioRisk. With more than one shard the
+// portfolio limit is applied as soon as each instrument publishes, so
+// results can vary with thread timing.
+inline void run_portfolio(const std::vector<const ContractSpec*>& instruments, int num_bars,
+                          unsigned shards, double max_loss) {
+    size_t n = instruments.size();
+    shards = std::max(1u, std::min<unsigned>(shards, (unsigned)n));
+    std::vector<int> cpus = allowed_cpus();
+    // Every instrument trades the default strategy; the portfolio allows
+    // what its instruments could trade between them
+    const StrategyParams params{};
+    PortfolioRisk risk(n, max_loss, (int)n * params.max_trades);
+
+    struct Row { RunStats stats; unsigned shard = 0; int bars = 0; bool stopped = false; };
+    std::vector<Row> rows(n);
+    std::vector<int>  shard_cpu(shards, -1);
+    std::vector<char> pinned(shards, 0);
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned k = 0; k < shards; ++k) {
+        threads.emplace_back([&, k] {
+            if (!cpus.empty()) shard_cpu[k] = cpus[k % cpus.size()];
+            pinned[k] = pin_thread(shard_cpu[k]);
+            // Engines built on the shard so their state is first touched here
+            std::vector<size_t> mine;
+            for (size_t i = k; i < n; i += shards) mine.push_back(i);
+            std::vector<std::unique_ptr<TradingEngine>> engines;
+            std::vector<int> last(mine.size(), num_bars);
+            for (size_t j = 0; j < mine.size(); ++j) {
+                engines.push_back(std::make_unique<TradingEngine>(params, *instruments[mine[j]]));
+                engines.back()->set_portfolio(&risk, mine[j]);
+            }
+
+            size_t live = mine.size();
+            std::vector<bool> alive(mine.size(), true);
+            for (int i = 1; i <= num_bars && live > 0; ++i) {
+                for (size_t j = 0; j < mine.size(); ++j) {
+                    if (!alive[j] || engines[j]->step(i)) continue;
+                    alive[j] = false;
+                    last[j] = i;
+                    --live;
+                }
+            }
+            for (size_t j = 0; j < mine.size(); ++j) {
+                engines[j]->close_out(last[j] + 1);
+                rows[mine[j]] = {engines[j]->stats(), k, last[j], !alive[j]};
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    auto t1 = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+    unsigned n_pinned = (unsigned)std::count(pinned.begin(), pinned.end(), 1);
+    std::printf("\n  %sPortfolio:%s %zu instruments x %d bars on %u shards, %u pinned "
+        "(max loss $%.0f, max %d trades)\n", clr::CYAN, clr::RESET, n, num_bars, shards, n_pinned,
+        std::abs(max_loss), (int)n * params.max_trades);
+    if (n_pinned < shards) {
+        std::printf("  %sPin failed:%s", clr::DIM, clr::RESET);
+        for (unsigned k = 0; k < shards; ++k)
+            if (!pinned[k]) std::printf(" shard %u (cpu %d)", k, shard_cpu[k]);
+        std::printf("\n");
+    }
+    std::printf("\n");
+
+    std::printf("  %s%-6s %5s %6s %6s %10s %6s %10s %7s%s\n", clr::DIM,
+        "Symbol", "Shard", "Trades", "Win%", "Net P&L", "PF", "MaxDD", "Bars", clr::RESET);
+    RunStats total;
+    long bars_run = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const RunStats& s = rows[i].stats;
+        double win_rate = s.trades > 0 ? 100.0 * s.wins / s.trades : 0;
+        std::printf("  %-6s %5u %6d %6.1f %s%10.2f%s %6.2f %10.2f %7d%s\n",
+            instruments[i]->symbol, rows[i].shard, s.trades, win_rate,
+            s.net >= 0 ? clr::GREEN : clr::RED, s.net, clr::RESET,
+            s.profit_factor, s.max_drawdown, rows[i].bars, rows[i].stopped ? "  (stopped)" : "");
+        total.trades += s.trades;
+        total.wins += s.wins;
+        total.net += s.net;
+        total.gross_profit += s.gross_profit;
+        total.gross_loss += s.gross_loss;
+        bars_run += rows[i].bars;
+    }
+    double pf = std::abs(total.gross_loss) > 0 ? total.gross_profit / std::abs(total.gross_loss) : 0;
+    double win_rate = total.trades > 0 ? 100.0 * total.wins / total.trades : 0;
+    std::printf("  %s──────────────────────────────────────────────────────────────────%s\n",
+        clr::DIM, clr::RESET);
+    std::printf("  %s%-6s %5s %6d %6.1f %s%10.2f%s %6.2f%s\n", clr::BOLD, "TOTAL", "",
+        total.trades, win_rate, total.net >= 0 ? clr::GREEN : clr::RED, total.net, clr::RESET, pf, clr::RESET);
+
+    if (risk.is_killed())
+        std::printf("\n  %s!!! PORTFOLIO LOSS LIMIT HIT — all instruments stopped !!!%s\n", clr::RED, clr::RESET);
+    std::printf("\n  %sExecution:%s %.1f ms (%ld instrument-bars, %.2fM bars/sec)\n\n",
+        clr::DIM, clr::RESET, ms, bars_run, bars_run / (ms * 1000.0));
+}
+
+// ── Seed Sweep (many simulated paths, --seeds) ──────────────────────────────
+// Runs the production strategy over `seeds` independently seeded paths for
+// every (volatility, mean reversion) setting, batched across the ThreadPool.
+// A path needs nothing but its seed (the simulator's draws are a pure
+// function of seed and bar index), so results are independent of --threads.
+struct SeedSweepOptions {
+    int      seeds = 1000;
+    uint32_t first_seed = 42;          // path k uses first_seed + k
+    std::vector<double> vols;          // empty: the contract's sim_vol
+    std::vector<double> mean_revs;     // empty: the contract's sim_mean_rev
+    unsigned threads = std::thread::hardware_concurrency();
+};
+
+inline void run_seed_sweep(const ContractSpec& base, int num_bars, SeedSweepOptions opt) {
+    if (opt.vols.empty()) opt.vols.push_back(base.sim_vol);
+    if (opt.mean_revs.empty()) opt.mean_revs.push_back(base.sim_mean_rev);
+    size_t seeds = (size_t)std::max(1, opt.seeds);
+    size_t settings = opt.vols.size() * opt.mean_revs.size();
+    size_t n = settings * seeds;
+
+    struct Path { RunStats stats; int bars = 0; };
+    std::vector<Path> paths(n);
+    ThreadPool pool(opt.threads);
+
+    std::printf("\n  %sSeed sweep:%s %s, %zu settings x %zu seeds x %d bars on %zu threads\n\n",
+        clr::CYAN, clr::RESET, base.symbol, settings, seeds, num_bars, pool.size());
+
+    auto t0 = std::chrono::steady_clock::now();
+    pool.parallel_for(n, [&](size_t i) {
+        ContractSpec spec = base;
+        size_t s = i / seeds;
+        spec.sim_vol = opt.vols[s / opt.mean_revs.size()];
+        spec.sim_mean_rev = opt.mean_revs[s % opt.mean_revs.size()];
+        spec.sim_seed = opt.first_seed + (uint32_t)(i % seeds);
+        TradingEngine engine(StrategyParams{}, spec);
+        int last = num_bars;
+        for (int b = 1; b <= num_bars; ++b)
+            if (!engine.step(b)) { last = b; break; }
+        engine.close_out(last + 1);
+        paths[i] = {engine.stats(), last};
+    });
+    auto t1 = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+    auto pct = [](std::vector<double>& v, double q) {
+        size_t k = std::min(v.size() - 1, (size_t)(q * (double)(v.size() - 1) + 0.5));
+        std::nth_element(v.begin(), v.begin() + k, v.end());
+        return v[k];
+    };
+
+    std::printf("  %s%6s %8s %10s %10s %10s %10s %7s %6s %6s %10s %10s%s\n", clr::DIM,
+        "Vol", "MeanRev", "Net p5", "Net p50", "Net p95", "Mean", "t", "Prof%", "Win%", "MaxDD p50",
+        "MaxDD p5", clr::RESET);
+    long bars_run = 0;
+    std::vector<double> net(seeds), win(seeds), dd(seeds);
+    for (size_t s = 0; s < settings; ++s) {
+        double sum = 0, sum2 = 0;
+        size_t profitable = 0;
+        for (size_t k = 0; k < seeds; ++k) {
+            const Path& p = paths[s * seeds + k];
+            net[k] = p.stats.net;
+            win[k] = p.stats.trades > 0 ? 100.0 * p.stats.wins / p.stats.trades : 0;
+            dd[k] = p.stats.max_drawdown;
+            sum += net[k];
+            sum2 += net[k] * net[k];
+            profitable += net[k] > 0;
+            bars_run += p.bars;
+        }
+        // t-statistic of the mean net P&L across paths: |t| < 2 is no edge
+        double mean = sum / (double)seeds;
+        double var = seeds > 1 ? (sum2 - sum * mean) / (double)(seeds - 1) : 0;
+        double t = var > 0 ? mean / std::sqrt(var / (double)seeds) : 0;
+        std::printf("  %6.2f %8.4f %10.2f %10.2f %10.2f %s%10.2f%s %7.2f %6.1f %6.1f %10.2f %10.2f\n",
+            opt.vols[s / opt.mean_revs.size()], opt.mean_revs[s % opt.mean_revs.size()],
+            pct(net, 0.05), pct(net, 0.50), pct(net, 0.95),
+            mean >= 0 ? clr::GREEN : clr::RED, mean, clr::RESET, t,
+            100.0 * (double)profitable / (double)seeds, pct(win, 0.50), pct(dd, 0.50), pct(dd, 0.05));
+    }
+
+    std::printf("\n  %sSeed sweep:%s %.1f ms (%zu paths, %ld bars, %.2fM bars/sec)\n\n",
+        clr::DIM, clr::RESET, ms, n, bars_run, bars_run / (ms * 1000.0));
+}
+
+// ── Monte Carlo (trade resampling, --mc) ────────────────────────────────────
+// Bootstraps the realised trade P&L sequence: each path redraws the same
+// number of trades with replacement, singly or as circular blocks of `block`
+// consecutive trades (keeps losing streaks together). Paths are split into
+// fixed chunks, each with its own seeded RNG, so results do not depend on the
+// thread count.
+struct MonteCarloOptions {
+    size_t   paths = 200000;
+    size_t   block = 1;         // 1 = i.i.d. trade bootstrap
+    double   ruin = -500;       // daily loss limit being tested (RiskManager)
+    uint64_t seed = 42;
+    unsigned threads = std::thread::hardware_concurrency();
+};
+
+struct MonteCarloResult {
+    static constexpr int NUM_PCT = 5;
+    static constexpr double PCTS[NUM_PCT] = {0.05, 0.25, 0.50, 0.75, 0.95};
+
+    size_t paths = 0, trades = 0, block = 1;
+    double net[NUM_PCT] = {};
+    double drawdown[NUM_PCT] = {};
+    double recovery[NUM_PCT] = {};     // longest stretch below a prior peak, in trades
+    double expectancy[NUM_PCT] = {};
+    double expectancy_lo = 0, expectancy_hi = 0;   // 95% interval
+    double ruin_prob = 0;              // P(cumulative P&L touches the loss limit)
+    double unrecovered = 0;            // share of paths ending below their peak
+    double ms = 0;
+};
+
+inline MonteCarloResult run_monte_carlo(const std::vector<Trade>& trades, const MonteCarloOptions& opt) {
+    MonteCarloResult res;
+    size_t n = trades.size();
+    if (n == 0 || opt.paths == 0) return res;
+    size_t block = std::clamp<size_t>(opt.block, 1, n);
+    res.paths = opt.paths;
+    res.trades = n;
+    res.block = block;
+
+    std::vector<double> pnl(n);
+    for (size_t i = 0; i < n; ++i) pnl[i] = trades[i].pnl;
+
+    // Per-path outputs, float is plenty for percentiles
+    std::vector<float> net(opt.paths), dd(opt.paths), rec(opt.paths);
+    std::vector<uint8_t> ruined(opt.paths), under(opt.paths);
+
+    constexpr size_t CHUNK = 4096;
+    size_t chunks = (opt.paths + CHUNK - 1) / CHUNK;
+    ThreadPool pool(opt.threads);
+
+    auto t0 = std::chrono::steady_clock::now();
+    pool.parallel_for(chunks, [&](size_t c) {
+        std::mt19937_64 rng(opt.seed + 0x9E3779B97F4A7C15ull * (c + 1));
+        std::uniform_int_distribution<size_t> pick(0, n - 1);
+        size_t end = std::min(opt.paths, (c + 1) * CHUNK);
+        for (size_t p = c * CHUNK; p < end; ++p) {
+            double eq = 0, peak = 0, max_dd = 0;
+            size_t below = 0, longest = 0;
+            bool hit = false;
+            for (size_t k = 0; k < n;) {
+                size_t s = pick(rng);
+                for (size_t j = 0; j < block && k < n; ++j, ++k) {
+                    eq += pnl[(s + j) % n];
+                    if (eq >= peak) { peak = eq; below = 0; }
+                    else longest = std::max(longest, ++below);
+                    max_dd = std::min(max_dd, eq - peak);
+                    hit |= eq <= opt.ruin;
+                }
+            }
+            net[p] = (float)eq;
+            dd[p] = (float)max_dd;
+            rec[p] = (float)longest;
+            ruined[p] = hit;
+            under[p] = below > 0;
+        }
+    }, 1);
+
+    auto pct = [](std::vector<float>& v, double q) {
+        size_t k = std::min(v.size() - 1, (size_t)(q * (double)(v.size() - 1) + 0.5));
+        std::nth_element(v.begin(), v.begin() + k, v.end());
+        return (double)v[k];
+    };
+    for (int i = 0; i < MonteCarloResult::NUM_PCT; ++i) {
+        double q = MonteCarloResult::PCTS[i];
+        res.net[i] = pct(net, q);
+        res.drawdown[i] = pct(dd, q);
+        res.recovery[i] = pct(rec, q);
+        res.expectancy[i] = res.net[i] / (double)n;
+    }
+    res.expectancy_lo = pct(net, 0.025) / (double)n;
+    res.expectancy_hi = pct(net, 0.975) / (double)n;
+    res.ruin_prob = (double)std::accumulate(ruined.begin(), ruined.end(), size_t{0}) / (double)opt.paths;
+    res.unrecovered = (double)std::accumulate(under.begin(), under.end(), size_t{0}) / (double)opt.paths;
+    auto t1 = std::chrono::steady_clock::now();
+    res.ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    return res;
+}
+
+inline void print_monte_carlo(const MonteCarloResult& r, double ruin, unsigned threads) {
+    if (r.paths == 0) {
+        std::printf("  %sMonte Carlo:%s no trades to resample\n\n", clr::CYAN, clr::RESET);
+        return;
+    }
+    std::printf("  %sMonte Carlo:%s %zu paths x %zu trades (block %zu)\n\n",
+        clr::CYAN, clr::RESET, r.paths, r.trades, r.block);
+    std::printf("  %s%-14s %10s %10s %10s %10s %10s%s\n", clr::DIM,
+        "", "p5", "p25", "p50", "p75", "p95", clr::RESET);
+    auto row = [](const char* name, const double* v, const char* fmt) {
+        std::printf("  %-14s", name);
+        for (int i = 0; i < MonteCarloResult::NUM_PCT; ++i) std::printf(fmt, v[i]);
+        std::printf("\n");
+    };
+    row("Net P&L", r.net, " %10.2f");
+    row("Max Drawdown", r.drawdown, " %10.2f");
+    row("Recovery (tr)", r.recovery, " %10.0f");
+    row("Expectancy", r.expectancy, " %10.2f");
+    std::printf("\n  %sExpectancy 95%%:%s [$%.2f, $%.2f] / trade\n",
+        clr::CYAN, clr::RESET, r.expectancy_lo, r.expectancy_hi);
+    std::printf("  %sRisk of ruin:%s  %s%.2f%%%s  (P&L touches -$%.0f)\n", clr::CYAN, clr::RESET,
+        r.ruin_prob > 0.05 ? clr::RED : clr::GREEN, 100.0 * r.ruin_prob, clr::RESET, std::abs(ruin));
+    std::printf("  %sUnrecovered:%s   %.2f%% of paths end below their peak\n", clr::CYAN, clr::RESET,
+        100.0 * r.unrecovered);
+    std::printf("\n  %sMonte Carlo:%s %.1f ms on %u threads (%.1fM trades/sec)\n\n", clr::DIM, clr::RESET,
+        r.ms, threads, (double)r.paths * (double)r.trades / (r.ms * 1000.0));
+}
+
+// ── CSV Importer (vendor ticks / bars -> bar store) ─────────────────────────
+// Accepts `time,price,size` ticks or `time,open,high,low,close,volume` bars
+// (detected from the field count; a leading header line is skipped). Time is
+// epoch s/ms/us/ns (by magnitude, fractional seconds allowed),
+// "YYYY-MM-DD[ T]HH:MM:SS[.f]" or NinjaTrader "YYYYMMDD HHMMSS[ fffffff]",
+// taken as-is (no timezone conversion).
+//
+// The input is mapped and split at line boundaries into chunks parsed on the
+// thread pool. Lines are tokenised with SIMD delimiter bitmasks and numbers
+// parsed in place with from_chars, so no field is ever allocated. Each chunk
+// aggregates into interval bars; neighbouring chunks are merged when a bar
+// straddles the boundary. Prices off the tick grid are rejected, the rest
+// stored as whole ticks.
+namespace csv {
+    struct Field { const char* b; const char* e; };
+    constexpr int MAX_FIELDS = 8;
+
+#if defined(__AVX2__)
+    constexpr size_t BLOCK = 32;
+    inline uint64_t delim_mask(const char* p, char delim) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(delim)),
+                                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+        return (uint32_t)_mm256_movemask_epi8(m);
+    }
+#elif defined(__SSE2__)
+    constexpr size_t BLOCK = 16;
+    inline uint64_t delim_mask(const char* p, char delim) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(delim)),
+                                 _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+        return (uint32_t)_mm_movemask_epi8(m);
+    }
+#else
+    constexpr size_t BLOCK = 8;
+    inline uint64_t delim_mask(const char* p, char delim) {
+        uint64_t m = 0;
+        for (size_t i = 0; i < BLOCK; ++i) m |= (uint64_t)(p[i] == delim || p[i] == '\n') << i;
+        return m;
+    }
+#endif
+
+    // Calls on_line(fields, n) for every line in [p, end); '\r' is left on
+    // the last field and ignored by the number parsers
+    template <class OnLine>
+    inline void scan_lines(const char* p, const char* end, char delim, OnLine&& on_line) {
+        Field f[MAX_FIELDS];
+        int nf = 0;
+        const char* start = p;
+        auto hit = [&](const char* d) {
+            if (nf < MAX_FIELDS) f[nf] = {start, d};
+            ++nf;
+            start = d + 1;
+            if (*d == '\n') { on_line(f, nf); nf = 0; }
+        };
+        const char* q = p;
+        for (; q + BLOCK <= end; q += BLOCK) {
+            for (uint64_t m = delim_mask(q, delim); m; m &= m - 1)
+                hit(q + __builtin_ctzll(m));
+        }
+        for (; q < end; ++q)
+            if (*q == delim || *q == '\n') hit(q);
+        if (start < end) {
+            if (nf < MAX_FIELDS) f[nf] = {start, end};
+            on_line(f, nf + 1);
+        }
+    }
+
+    inline bool parse_double(Field f, double& out) {
+        while (f.b < f.e && *f.b == ' ') ++f.b;
+        auto r = std::from_chars(f.b, f.e, out);
+        return r.ec == std::errc() && (r.ptr == f.e || *r.ptr == '\r' || *r.ptr == ' ');
+    }
+
+    inline bool digits(const char* p, int n, int& out) {
+        out = 0;
+        for (int i = 0; i < n; ++i) {
+            unsigned d = (unsigned)(p[i] - '0');
+            if (d > 9) return false;
+            out = out * 10 + (int)d;
         }
+        return true;
+    }
 
-        print_results();
-        export_json("results.json");
+    inline int64_t days_from_civil(int y, unsigned m, unsigned d) {
+        y -= m <= 2;
+        const int era = (y >= 0 ? y : y - 399) / 400;
+        const unsigned yoe = (unsigned)(y - era * 400);
+        const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+        const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097LL + (int64_t)doe - 719468;
     }
 
-    void export_json(const char* path) {
-        std::ofstream f(path);
-        if (!f) return;
+    // Timestamp field -> ns
+    inline bool parse_time(Field f, int64_t& ns) {
+        const char* p = f.b;
+        size_t len = (size_t)(f.e - f.b);
+        int Y, M, D, h, m, sec;
+        auto civil = [&] { return (days_from_civil(Y, M, D) * 86400 + h * 3600 + m * 60 + sec) * 1'000'000'000LL; };
 
-        // Stats
-        int wins = 0, losses = 0;
-        double gross_profit = 0, gross_loss = 0;
-        for (const auto& t : trades_) {
-            if (t.pnl >= 0) { ++wins; gross_profit += t.pnl; }
-            else { ++losses; gross_loss += t.pnl; }
+        if (len >= 19 && p[4] == '-' && p[7] == '-' && (p[10] == ' ' || p[10] == 'T') && p[13] == ':' && p[16] == ':') {
+            if (!digits(p, 4, Y) || !digits(p + 5, 2, M) || !digits(p + 8, 2, D)
+                || !digits(p + 11, 2, h) || !digits(p + 14, 2, m) || !digits(p + 17, 2, sec)) return false;
+            ns = civil();
+            if (len > 20 && p[19] == '.') {
+                int64_t frac = 0, scale = 100'000'000;
+                for (const char* q = p + 20; q < f.e && *q >= '0' && *q <= '9' && scale > 0; ++q, scale /= 10)
+                    frac += (*q - '0') * scale;
+                ns += frac;
+            }
+            return true;
         }
-        int total = (int)trades_.size();
-        double net = gross_profit + gross_loss;
-        double win_rate = total > 0 ? 100.0 * wins / total : 0;
-        double pf = std::abs(gross_loss) > 0 ? gross_profit / std::abs(gross_loss) : 0;
-
-        f << "{\n";
-        // Stats
-        f << "\"stats\":{";
-        f << "\"trades\":" << total << ",\"wins\":" << wins << ",\"losses\":" << losses;
-        f << ",\"win_rate\":" << std::fixed;
-        f.precision(1); f << win_rate;
-        f << ",\"net_pnl\":"; f.precision(2); f << net;
-        f << ",\"gross_profit\":" << gross_profit;
-        f << ",\"gross_loss\":" << gross_loss;
-        f << ",\"profit_factor\":"; f.precision(2); f << pf;
-        f << ",\"max_drawdown\":" << max_drawdown_;
-        f << ",\"expectancy\":"; f << (total > 0 ? net / total : 0.0);
-        f << "},\n";
-
-        // Trades
-        f << "\"trades\":[";
-        for (size_t i = 0; i < trades_.size(); ++i) {
-            const auto& t = trades_[i];
-            if (i > 0) f << ",";
-            f << "\n{\"entry_bar\":" << t.entry_bar;
-            f << ",\"exit_bar\":" << t.exit_bar;
-            f << ",\"side\":\"" << (t.side == Side::LONG ? "LONG" : "SHORT") << "\"";
-            f << ",\"entry\":" << t.entry_price;
-            f << ",\"exit\":" << t.exit_price;
-            f << ",\"pnl\":" << t.pnl;
-            f << ",\"reason\":\"" << t.exit_reason << "\"}";
+        if (len >= 15 && p[8] == ' ') {
+            if (!digits(p, 4, Y) || !digits(p + 4, 2, M) || !digits(p + 6, 2, D)
+                || !digits(p + 9, 2, h) || !digits(p + 11, 2, m) || !digits(p + 13, 2, sec)) return false;
+            ns = civil();
+            int ticks100;   // optional 7-digit 100ns fraction
+            if (len >= 23 && p[15] == ' ' && digits(p + 16, 7, ticks100)) ns += ticks100 * 100LL;
+            return true;
         }
-        f << "\n],\n";
 
-        // Equity curve
-        f << "\"equity\":[";
-        for (size_t i = 0; i < equity_curve_.size(); ++i) {
-            if (i > 0) f << ",";
-            f << "[" << equity_curve_[i].bar << "," << equity_curve_[i].pnl << "]";
+        int64_t whole;
+        auto r = std::from_chars(p, f.e, whole);
+        if (r.ec != std::errc()) return false;
+        if (r.ptr < f.e && *r.ptr == '.') {          // fractional epoch seconds
+            double secs;
+            if (!parse_double(f, secs)) return false;
+            ns = (int64_t)std::llround(secs * 1e9);
+            return true;
         }
-        f << "],\n";
+        if (r.ptr < f.e && *r.ptr != '\r' && *r.ptr != ' ') return false;
+        int64_t a = whole < 0 ? -whole : whole;
+        ns = a < 100'000'000'000LL         ? whole * 1'000'000'000LL   // s
+           : a < 100'000'000'000'000LL     ? whole * 1'000'000LL       // ms
+           : a < 100'000'000'000'000'000LL ? whole * 1'000LL           // us
+           : whole;                                                    // ns
+        return true;
+    }
+}
 
-        // Price data (sample every 5 bars for chart)
-        f << "\"bars\":[";
-        bool first = true;
-        for (size_t i = 0; i < bar_history_.size(); i += 3) {
-            const auto& b = bar_history_[i];
-            if (!first) f << ",";
-            first = false;
-            f << "\n[" << b.idx << "," << b.close << "," << b.rsi << ","
-              << b.ema9 << "," << b.ema21 << "," << b.vwap << "," << b.atr << "]";
-        }
-        f << "\n]\n}\n";
-        f.close();
-        std::printf("  %sJSON exported:%s results.json\n", clr::CYAN, clr::RESET);
+struct ImportStats {
+    uint64_t lines = 0, rows = 0, header = 0;
+    uint64_t malformed = 0, off_tick = 0, out_of_order = 0;
+
+    void add(const ImportStats& o) {
+        lines += o.lines; rows += o.rows; header += o.header;
+        malformed += o.malformed; off_tick += o.off_tick; out_of_order += o.out_of_order;
     }
+};
+
+class CsvImporter {
+public:
+    struct Options {
+        std::string symbol   = "ES";
+        double   tick_size   = 0.25;
+        int64_t  interval_ns = MarketSimulator::BAR_NS;
+        char     delim       = ',';
+        unsigned threads     = std::thread::hardware_concurrency();
+    };
 
 private:
-    void open_position(const Bar& bar, const Signal& sig) {
-        double atr = signal_.atr_val();
-        if (atr < TICK_SIZE) atr = 2.0; // fallback
+    // Bar under construction; pv keeps the VWAP numerator until the end
+    struct PartialBar { Bar bar; double pv; };
 
-        entry_price_ = bar.close;
-        entry_bar_ = bar.index;
-        max_favorable_ = 0;
+    struct Chunk {
+        const char* b;
+        const char* e;
+        std::vector<PartialBar> bars;
+        ImportStats stats;
+    };
 
-        if (sig.action == TradeAction::BUY) {
-            pos_side_ = Side::LONG;
-            stop_price_   = entry_price_ - 1.5 * atr;  // Tighter stop
-            target_price_ = entry_price_ + 3.0 * atr;  // 1:2 R:R
-        } else {
-            pos_side_ = Side::SHORT;
-            stop_price_   = entry_price_ + 1.5 * atr;
-            target_price_ = entry_price_ - 3.0 * atr;
-        }
-        // Snap to ticks
-        stop_price_   = std::round(stop_price_ / TICK_SIZE) * TICK_SIZE;
-        target_price_ = std::round(target_price_ / TICK_SIZE) * TICK_SIZE;
+    Options opt_;
+
+    // 3 fields = tick, 6+ = bar (extra columns ignored); detected on the
+    // first data line of the file
+    static int layout(int nf) { return nf == 3 ? 3 : nf >= 6 ? 6 : 0; }
+
+    // Price -> whole ticks; false if off the tick grid or out of Ticks range
+    bool to_ticks(double px, Ticks& out) const {
+        double ticks = px / opt_.tick_size;
+        double r = std::round(ticks);
+        if (std::abs(ticks - r) > 1e-6 || std::abs(r) > (double)INT32_MAX) return false;
+        out = (Ticks)r;
+        return true;
     }
 
-    std::pair<bool, std::string> check_exit(const Bar& bar) {
-        bool is_long = pos_side_ == Side::LONG;
-        double current = bar.close;
+    void parse_chunk(Chunk& c, int fields, bool first) const {
+        PartialBar cur{};
+        bool open = false;
+        bool first_line = first;
+        c.bars.reserve((size_t)(c.e - c.b) / 2048 + 16);
 
-        // P&L in ticks
-        double pnl_ticks = is_long ? (current - entry_price_) / TICK_SIZE
-                                   : (entry_price_ - current) / TICK_SIZE;
+        csv::scan_lines(c.b, c.e, opt_.delim, [&](const csv::Field* f, int nf) {
+            ++c.stats.lines;
+            bool was_first = first_line;
+            first_line = false;
+            if (nf == 1 && f[0].e - f[0].b <= 1) return;          // blank line
 
-        if (pnl_ticks > max_favorable_) max_favorable_ = pnl_ticks;
+            int64_t t;
+            double po, ph, pl, pc, v;
+            bool ok = layout(nf) == fields && csv::parse_time(f[0], t);
+            if (ok && fields == 3) {
+                ok = csv::parse_double(f[1], pc) && csv::parse_double(f[2], v);
+                po = ph = pl = pc;
+            } else if (ok) {
+                ok = csv::parse_double(f[1], po) && csv::parse_double(f[2], ph)
+                  && csv::parse_double(f[3], pl) && csv::parse_double(f[4], pc)
+                  && csv::parse_double(f[5], v);
+            }
+            if (!ok) {
+                if (was_first) ++c.stats.header; else ++c.stats.malformed;
+                return;
+            }
+            Ticks o, h, l, cl;
+            if (!to_ticks(po, o) || !to_ticks(ph, h) || !to_ticks(pl, l) || !to_ticks(pc, cl)) { ++c.stats.off_tick; return; }
 
-        // Trailing stop: if gained > 8 ticks, trail at 50%
-        if (max_favorable_ > 8.0) {
-            double trail;
-            if (is_long) {
-                trail = entry_price_ + (max_favorable_ * trailing_pct_) * TICK_SIZE;
-                if (trail > stop_price_) stop_price_ = trail;
+            int64_t bucket = t - ((t % opt_.interval_ns) + opt_.interval_ns) % opt_.interval_ns;
+            double pv = (fields == 3 ? cl : (h + l + cl) / 3.0) * v;
+            if (open && bucket < cur.bar.time) { ++c.stats.out_of_order; return; }
+            ++c.stats.rows;
+
+            if (open && bucket == cur.bar.time) {
+                cur.bar.high = std::max(cur.bar.high, h);
+                cur.bar.low  = std::min(cur.bar.low, l);
+                cur.bar.close = cl;
+                cur.bar.volume += v;
+                cur.pv += pv;
             } else {
-                trail = entry_price_ - (max_favorable_ * trailing_pct_) * TICK_SIZE;
-                if (trail < stop_price_) stop_price_ = trail;
+                if (open) c.bars.push_back(cur);
+                cur = {{0, o, h, l, cl, v, 0, bucket}, pv};
+                open = true;
             }
+        });
+        if (open) c.bars.push_back(cur);
+    }
+
+public:
+    explicit CsvImporter(const Options& opt) : opt_(opt) {}
+
+    // Returns false (with a message on stderr) on I/O or format errors
+    bool run(const char* in_path, const char* out_path) {
+        auto t0 = std::chrono::steady_clock::now();
+
+        int fd = ::open(in_path, O_RDONLY);
+        if (fd < 0) { std::fprintf(stderr, "Cannot open %s: %s\n", in_path, std::strerror(errno)); return false; }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            std::fprintf(stderr, "Empty or unreadable input: %s\n", in_path);
+            return false;
         }
+        size_t len = (size_t)st.st_size;
+        void* map = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED) { std::fprintf(stderr, "mmap failed: %s\n", std::strerror(errno)); return false; }
+        ::madvise(map, len, MADV_SEQUENTIAL);
+        const char* data = static_cast<const char*>(map);
+        const char* end = data + len;
 
-        // Stop hit
-        if (is_long && current <= stop_price_) return {true, max_favorable_ > 6 ? "TRAILING_STOP" : "STOP_LOSS"};
-        if (!is_long && current >= stop_price_) return {true, max_favorable_ > 6 ? "TRAILING_STOP" : "STOP_LOSS"};
+        // Field layout from the first line that is not a header
+        int fields = 0;
+        for (const char* line = data; line < end && fields == 0;) {
+            const char* nl = static_cast<const char*>(std::memchr(line, '\n', (size_t)(end - line)));
+            if (!nl) nl = end;
+            csv::scan_lines(line, nl, opt_.delim, [&](const csv::Field* f, int nf) {
+                int64_t t;
+                if (csv::parse_time(f[0], t)) fields = layout(nf);
+            });
+            line = nl + 1;
+            if (line - data > 4096) break;
+        }
+        if (fields == 0) {
+            ::munmap(map, len);
+            std::fprintf(stderr, "Unrecognised CSV layout (expected time,price,size or time,o,h,l,c,v)\n");
+            return false;
+        }
 
-        // Target hit
-        if (is_long && current >= target_price_) return {true, "TAKE_PROFIT"};
-        if (!is_long && current <= target_price_) return {true, "TAKE_PROFIT"};
+        // Chunks split at line boundaries, several per thread for balance
+        ThreadPool pool(opt_.threads);
+        size_t target = std::max<size_t>(1 << 20, len / (pool.size() * 4) + 1);
+        std::vector<Chunk> chunks;
+        for (const char* b = data; b < end;) {
+            const char* e = b + std::min(target, (size_t)(end - b));
+            if (e < end) {
+                const char* nl = static_cast<const char*>(std::memchr(e, '\n', (size_t)(end - e)));
+                e = nl ? nl + 1 : end;
+            }
+            chunks.push_back({b, e, {}, {}});
+            b = e;
+        }
+        pool.parallel_for(chunks.size(), [&](size_t i) { parse_chunk(chunks[i], fields, i == 0); }, 1);
 
-        // Max hold: 50 bars (~4 min)
-        if (bar.index - entry_bar_ > 50) return {true, "MAX_HOLD"};
+        // Stitch chunks in order, merging a bar split across a boundary
+        ImportStats stats;
+        std::vector<PartialBar> bars;
+        size_t total = 0;
+        for (const auto& c : chunks) total += c.bars.size();
+        bars.reserve(total);
+        for (auto& c : chunks) {
+            stats.add(c.stats);
+            for (const auto& pb : c.bars) {
+                if (!bars.empty()) {
+                    auto& last = bars.back();
+                    if (pb.bar.time < last.bar.time) { ++stats.out_of_order; continue; }
+                    if (pb.bar.time == last.bar.time) {
+                        last.bar.high = std::max(last.bar.high, pb.bar.high);
+                        last.bar.low  = std::min(last.bar.low, pb.bar.low);
+                        last.bar.close = pb.bar.close;
+                        last.bar.volume += pb.bar.volume;
+                        last.pv += pb.pv;
+                        continue;
+                    }
+                }
+                bars.push_back(pb);
+            }
+            std::vector<PartialBar>().swap(c.bars);
+        }
+        ::munmap(map, len);
+        if (stats.rows == 0) {
+            std::fprintf(stderr, "No rows accepted from %s (%llu malformed, %llu off-tick, %llu out-of-order)\n",
+                in_path, (unsigned long long)stats.malformed, (unsigned long long)stats.off_tick,
+                (unsigned long long)stats.out_of_order);
+            return false;
+        }
+
+        BarStoreWriter out;
+        bool ok = out.open(out_path, opt_.symbol.c_str(), opt_.interval_ns, opt_.tick_size);
+        for (size_t i = 0; ok && i < bars.size(); ++i) {
+            Bar b = bars[i].bar;
+            b.index = (int)i + 1;
+            b.vwap = b.volume > 0 ? bars[i].pv / b.volume : (b.high + b.low + b.close) / 3.0;
+            ok = out.append(b);
+        }
+        ok = out.close() && ok;
+        if (!ok) { std::fprintf(stderr, "Cannot write bar store: %s\n", out_path); return false; }
 
-        return {false, ""};
+        auto t1 = std::chrono::steady_clock::now();
+        double sec = std::chrono::duration<double>(t1 - t0).count();
+        std::printf("\n  %sImported:%s %s -> %s (%s, %zu chunks on %zu threads)\n",
+            clr::CYAN, clr::RESET, in_path, out_path, fields == 3 ? "ticks" : "bars",
+            chunks.size(), pool.size());
+        std::printf("  %sRows:%s %llu accepted | %llu header | %s%llu malformed | %llu off-tick | %llu out-of-order%s\n",
+            clr::CYAN, clr::RESET, (unsigned long long)stats.rows, (unsigned long long)stats.header,
+            stats.malformed + stats.off_tick + stats.out_of_order ? clr::YELLOW : clr::RESET,
+            (unsigned long long)stats.malformed, (unsigned long long)stats.off_tick,
+            (unsigned long long)stats.out_of_order, clr::RESET);
+        std::printf("  %sBars:%s %zu x %.0fs %s\n", clr::CYAN, clr::RESET,
+            bars.size(), opt_.interval_ns / 1e9, opt_.symbol.c_str());
+        std::printf("  %sThroughput:%s %.1f ms (%.0f MB/s, %.1fM rows/sec)\n\n", clr::DIM, clr::RESET,
+            sec * 1000, len / sec / 1e6, stats.rows / sec / 1e6);
+        return true;
     }
+};
 
-    void close_position(const Bar& bar, const std::string& reason) {
-        double pnl_points = pos_side_ == Side::LONG
-            ? bar.close - entry_price_
-            : entry_price_ - bar.close;
-        double pnl_dollars = pnl_points * POINT_VALUE;
+// ── Allocation Check (--alloc-check) ────────────────────────────────────────
+// Runs the headless bar loop and the tick-driven loop on pre-built inputs and
+// counts heap allocations from the first bar to the last. Returns false if
+// either loop allocated.
+inline bool run_alloc_check(int num_bars) {
+    std::vector<Bar> bars = simulate_bars(num_bars);
+    std::vector<MarketEvent> events;
+    events.reserve((size_t)num_bars * (MarketSimulator::TICKS_PER_BAR + 2));
+    MarketSimulator market;
+    for (int i = 1; i <= num_bars; ++i)
+        market.next_bar(i, [&](const MarketEvent& ev) { events.push_back(ev); });
 
-        // Subtract commission ($1.70 round trip)
-        pnl_dollars -= 1.70;
+    TradingEngine bar_engine, tick_engine;
+    uint64_t a0 = alloc::count;
+    RunStats bar_stats = bar_engine.backtest(bars.data(), bars.size());
+    uint64_t a1 = alloc::count;
+    RunStats tick_stats = tick_engine.backtest_events(events.data(), events.size());
+    uint64_t a2 = alloc::count;
 
-        trades_.push_back({entry_bar_, bar.index, pos_side_, entry_price_, bar.close, pnl_dollars, reason});
-        risk_.record(pnl_dollars);
-        pos_side_ = Side::NONE;
+    auto report = [](const char* mode, uint64_t n, int trades, size_t units, const char* unit) {
+        std::printf("  %s%-6s%s %llu allocations over %zu %s (%d trades)  %s%s%s\n",
+            clr::CYAN, mode, clr::RESET, (unsigned long long)n, units, unit, trades,
+            n == 0 ? clr::GREEN : clr::RED, n == 0 ? "OK" : "FAIL", clr::RESET);
+    };
+    std::printf("\n  %sAllocation check%s\n", clr::BOLD, clr::RESET);
+    report("Bars:", a1 - a0, bar_stats.trades, bars.size(), "bars");
+    report("Ticks:", a2 - a1, tick_stats.trades, events.size(), "events");
+    std::printf("\n");
+    return a1 == a0 && a2 == a1;
+}
+
+// ── Indicator Bank Check (--bank) ───────────────────────────────────────────
+// Runs `lanes` independently seeded instruments, each with its own periods,
+// through the SoA bank and through the scalar classes; reports the largest
+// deviation per indicator and the update throughput of both.
+template <class T>
+inline void run_bank_check(int lanes, int num_bars) {
+    std::vector<StrategyParams> params(lanes);
+    for (int k = 0; k < lanes; ++k) {
+        params[k].rsi_period = 10 + k % 8;
+        params[k].ema_fast   = 7 + k % 5;
+        params[k].ema_slow   = 18 + k % 7;
+        params[k].ema_trend  = 40 + k % 20;
+        params[k].atr_period = 10 + k % 9;
     }
 
-    void print_header() {
-        std::printf("\n%s", clr::BOLD);
-        std::printf("  ____                  _____           __\n");
-        std::printf(" / __ \\__  ______ _____/ / __/_______ _/ /___\n");
-        std::printf("/ / / / / / / __ `/ __  /\\__ \\/ ___/ __  / __ \\\n");
-        std::printf("/ /_/ / /_/ / /_/ / /_/ /___/ / /__/ /_/ / /_/ /\n");
-        std::printf("\\___\\_\\__,_/\\__,_/\\__,_//____/\\___/\\__,_/ .___/\n");
-        std::printf("                                       /_/\n");
-        std::printf("%s\n", clr::RESET);
-        std::printf("  %sInstrument:%s ES (simulated)  %sBars:%s 5sec  %sMode:%s Paper\n",
-            clr::CYAN, clr::RESET, clr::CYAN, clr::RESET, clr::CYAN, clr::RESET);
-        std::printf("  %sRisk:%s Max loss $500/day | Stop 2xATR | Target 3xATR | Trail 50%%\n\n",
-            clr::CYAN, clr::RESET);
-        std::printf("  %s%-6s %10s %7s %9s %9s %9s %9s%s\n",
-            clr::DIM, "Bar", "Price", "RSI", "EMA9", "EMA21", "VWAP", "ATR", clr::RESET);
-        std::printf("  %s──────────────────────────────────────────────────────────────────%s\n",
-            clr::DIM, clr::RESET);
+    // Bars stored bar-major, SoA across lanes
+    size_t total = (size_t)lanes * num_bars;
+    std::vector<T> hi(total), lo(total), cl(total), vol(total);
+    std::vector<Bar> bars(total);
+    for (int k = 0; k < lanes; ++k) {
+        MarketSimulator market(5250.0, 0.25, 1.1, 0.001, 42 + k);
+        for (int i = 0; i < num_bars; ++i) {
+            Bar b = market.next_bar(i + 1);
+            size_t at = (size_t)i * lanes + k;
+            bars[at] = b;
+            hi[at] = (T)b.high; lo[at] = (T)b.low; cl[at] = (T)b.close; vol[at] = (T)b.volume;
+        }
     }
 
-    void print_bar(const Bar& bar, const Signal& sig) {
-        const char* sig_color = clr::RESET;
-        const char* sig_char = " ";
-        if (sig.action == TradeAction::BUY)  { sig_color = clr::GREEN; sig_char = "+"; }
-        if (sig.action == TradeAction::SELL) { sig_color = clr::RED;   sig_char = "-"; }
+    struct Scalar {
+        RSI<> rsi; EMA<> ef, es, et; ATR<> atr; VWAP vwap;
+        explicit Scalar(const StrategyParams& p)
+            : rsi(p.rsi_period), ef(p.ema_fast), es(p.ema_slow), et(p.ema_trend), atr(p.atr_period) {}
+    };
+    std::vector<Scalar> scalar;
+    scalar.reserve(lanes);
+    for (const auto& p : params) scalar.emplace_back(p);
+    IndicatorBank<T> bank(params);
 
-        // RSI color
-        const char* rsi_c = clr::RESET;
-        if (signal_.rsi() < 30) rsi_c = clr::GREEN;
-        if (signal_.rsi() > 70) rsi_c = clr::RED;
+    double err_rsi = 0, err_ema = 0, err_atr = 0, err_vwap = 0;
+    auto rel = [](double a, double b) { return std::abs(a - b) / std::max(1e-12, std::abs(b)); };
+    for (int i = 0; i < num_bars; ++i) {
+        size_t at = (size_t)i * lanes;
+        bank.update(&hi[at], &lo[at], &cl[at], &vol[at]);
+        for (int k = 0; k < lanes; ++k) {
+            const Bar& b = bars[at + k];
+            auto& s = scalar[k];
+            s.rsi.update(b.close); s.ef.update(b.close); s.es.update(b.close); s.et.update(b.close);
+            s.atr.update(b.high, b.low, b.close); s.vwap.update(b.close, b.volume);
+            err_rsi  = std::max(err_rsi, std::abs((double)bank.rsi(k) - s.rsi.value()));
+            err_ema  = std::max({err_ema, rel(bank.ema(IndicatorBank<T>::FAST, k), s.ef.value()),
+                                 rel(bank.ema(IndicatorBank<T>::SLOW, k), s.es.value()),
+                                 rel(bank.ema(IndicatorBank<T>::TREND, k), s.et.value())});
+            err_atr  = std::max(err_atr, rel(bank.atr(k), s.atr.value()));
+            err_vwap = std::max(err_vwap, rel(bank.vwap(k), s.vwap.value()));
+            if (bank.rsi_ready(k) != s.rsi.ready() || bank.atr_ready(k) != s.atr.ready()
+                || bank.ema_ready(IndicatorBank<T>::TREND, k) != s.et.ready()) {
+                std::printf("  %sReady-state mismatch: lane %d bar %d%s\n", clr::RED, k, i + 1, clr::RESET);
+                return;
+            }
+        }
+    }
 
-        std::printf("  %s[%04d]%s %10.2f %s%7.1f%s %9.2f %9.2f %9.2f %9.2f %s%s%s\n",
-            clr::DIM, bar.index, clr::RESET,
-            bar.close,
-            rsi_c, signal_.rsi(), clr::RESET,
-            signal_.ema9(), signal_.ema21(),
-            signal_.vwap_val(), signal_.atr_val(),
-            sig_color, sig_char, clr::RESET);
+    // Throughput: fresh bank vs fresh scalar set over the same data
+    IndicatorBank<T> timed(params);
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_bars; ++i) {
+        size_t at = (size_t)i * lanes;
+        timed.update(&hi[at], &lo[at], &cl[at], &vol[at]);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    std::vector<Scalar> ref;
+    ref.reserve(lanes);
+    for (const auto& p : params) ref.emplace_back(p);
+    for (int i = 0; i < num_bars; ++i) {
+        for (int k = 0; k < lanes; ++k) {
+            const Bar& b = bars[(size_t)i * lanes + k];
+            auto& s = ref[k];
+            s.rsi.update(b.close); s.ef.update(b.close); s.es.update(b.close); s.et.update(b.close);
+            s.atr.update(b.high, b.low, b.close); s.vwap.update(b.close, b.volume);
+        }
     }
+    auto t2 = std::chrono::steady_clock::now();
+    volatile double sink = timed.rsi(0) + ref[0].rsi.value();
+    (void)sink;
 
-    void print_results() {
-        std::printf("\n  %s══════════════════════════════════════════════════════════════════%s\n", clr::BOLD, clr::RESET);
-        std::printf("  %s                    RESULTATS DE SIMULATION%s\n", clr::BOLD, clr::RESET);
-        std::printf("  %s══════════════════════════════════════════════════════════════════%s\n\n", clr::BOLD, clr::RESET);
+    double bank_ns   = std::chrono::duration<double, std::nano>(t1 - t0).count() / total;
+    double scalar_ns = std::chrono::duration<double, std::nano>(t2 - t1).count() / total;
+    bool exact = err_rsi == 0 && err_ema == 0 && err_atr == 0 && err_vwap == 0;
 
-        if (trades_.empty()) {
-            std::printf("  Aucun trade execute.\n");
-            return;
-        }
+    std::printf("\n  %sIndicator bank:%s %s, %zu lanes/vector, %d lanes x %d bars\n",
+        clr::CYAN, clr::RESET, sizeof(T) == 8 ? "double" : "float", simd::width<T>, lanes, num_bars);
+    std::printf("  %sMax error:%s RSI %.3g pts | EMA %.3g | ATR %.3g | VWAP %.3g (rel)  %s%s%s\n",
+        clr::CYAN, clr::RESET, err_rsi, err_ema, err_atr, err_vwap,
+        exact ? clr::GREEN : clr::YELLOW, exact ? "bit-exact" : "within tolerance", clr::RESET);
+    std::printf("  %sUpdate:%s bank %.2f ns/lane | scalar %.2f ns/lane (%.1fx)\n\n",
+        clr::DIM, clr::RESET, bank_ns, scalar_ns, scalar_ns / bank_ns);
+}
 
-        int wins = 0, losses = 0;
-        double gross_profit = 0, gross_loss = 0;
-        double best_trade = -1e9, worst_trade = 1e9;
-        int stops = 0, targets = 0, trails = 0, max_holds = 0;
+// ── Journal Verify (--verify) ───────────────────────────────────────────────
+// Rebuilds the engine a journal was recorded with (contract, starting
+// parameters, tick mode, order manager), replays its inputs as fast as the
+// engine runs and checks that every record comes out identical.
+inline bool run_journal_verify(const char* path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) {
+        std::fprintf(stderr, "Cannot read journal: %s\n", path);
+        return false;
+    }
+    std::vector<char> data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    journal::Header h;
+    if (data.size() < sizeof(h)) {
+        std::fprintf(stderr, "%s: truncated journal header\n", path);
+        return false;
+    }
+    std::memcpy(&h, data.data(), sizeof(h));
+    if (std::memcmp(h.magic, journal::MAGIC, sizeof(h.magic)) != 0 || h.version != journal::VERSION) {
+        std::fprintf(stderr, "%s: not a version %u journal\n", path, journal::VERSION);
+        return false;
+    }
 
-        for (const auto& t : trades_) {
-            if (t.pnl >= 0) { ++wins; gross_profit += t.pnl; }
-            else { ++losses; gross_loss += t.pnl; }
-            best_trade = std::max(best_trade, t.pnl);
-            worst_trade = std::min(worst_trade, t.pnl);
-            if (t.exit_reason == "STOP_LOSS") ++stops;
-            if (t.exit_reason == "TAKE_PROFIT") ++targets;
-            if (t.exit_reason == "TRAILING_STOP") ++trails;
-            if (t.exit_reason == "MAX_HOLD") ++max_holds;
-        }
+    // Records up to the last complete one; anything after it is a torn write
+    journal::Cursor scan(data.data() + sizeof(h), data.size() - sizeof(h));
+    journal::RecordHeader rh;
+    const char* p;
+    uint64_t records = 0;
+    while (scan.next(rh, p)) ++records;
+    size_t torn = (size_t)(data.data() + data.size() - scan.pos());
 
-        int total = (int)trades_.size();
-        double net = gross_profit + gross_loss;
-        double win_rate = total > 0 ? 100.0 * wins / total : 0;
-        double avg_win = wins > 0 ? gross_profit / wins : 0;
-        double avg_loss = losses > 0 ? gross_loss / losses : 0;
-        double pf = std::abs(gross_loss) > 0 ? gross_profit / std::abs(gross_loss) : 999;
-        double expectancy = total > 0 ? net / total : 0;
+    journal::Cursor in(data.data() + sizeof(h), (size_t)(scan.pos() - data.data()) - sizeof(h));
+    if (!in.next(rh, p) || rh.type != journal::CONFIG || rh.size != sizeof(journal::ConfigRecord)) {
+        std::fprintf(stderr, "%s: journal does not start with its parameters\n", path);
+        return false;
+    }
+    StrategyParams params = journal::from_record(journal::payload<journal::ConfigRecord>(p));
 
-        const char* net_c = net >= 0 ? clr::GREEN : clr::RED;
+    ContractSpec spec = CONTRACTS[0];
+    std::string symbol(h.symbol, strnlen(h.symbol, sizeof(h.symbol)));
+    if (const ContractSpec* c = find_contract(symbol)) spec = *c;
+    spec.tick_size = h.tick_size;
+    spec.tick_value = h.tick_value;
+    spec.commission = h.commission;
 
-        std::printf("  %sTrades:%s       %d total | %s%d wins%s | %s%d losses%s\n",
-            clr::CYAN, clr::RESET, total,
-            clr::GREEN, wins, clr::RESET,
-            clr::RED, losses, clr::RESET);
-        std::printf("  %sWin Rate:%s     %.1f%%\n", clr::CYAN, clr::RESET, win_rate);
-        std::printf("\n");
-        std::printf("  %sGross Profit:%s %s$%.2f%s\n", clr::CYAN, clr::RESET, clr::GREEN, gross_profit, clr::RESET);
-        std::printf("  %sGross Loss:%s   %s$%.2f%s\n", clr::CYAN, clr::RESET, clr::RED, gross_loss, clr::RESET);
-        std::printf("  %s────────────────────────────────%s\n", clr::DIM, clr::RESET);
-        std::printf("  %sNet P&L:%s      %s%s$%.2f%s\n",
-            clr::BOLD, clr::RESET, clr::BOLD, net_c, net, clr::RESET);
-        std::printf("\n");
-        std::printf("  %sProfit Factor:%s %.2f\n", clr::CYAN, clr::RESET, pf);
-        std::printf("  %sExpectancy:%s   $%.2f / trade\n", clr::CYAN, clr::RESET, expectancy);
-        std::printf("  %sMax Drawdown:%s %s$%.2f%s\n", clr::CYAN, clr::RESET, clr::RED, max_drawdown_, clr::RESET);
-        std::printf("\n");
-        std::printf("  %sAvg Win:%s      $%.2f\n", clr::CYAN, clr::RESET, avg_win);
-        std::printf("  %sAvg Loss:%s     $%.2f\n", clr::CYAN, clr::RESET, avg_loss);
-        std::printf("  %sBest Trade:%s   %s$%.2f%s\n", clr::CYAN, clr::RESET, clr::GREEN, best_trade, clr::RESET);
-        std::printf("  %sWorst Trade:%s  %s$%.2f%s\n", clr::CYAN, clr::RESET, clr::RED, worst_trade, clr::RESET);
-        std::printf("\n");
-        std::printf("  %sExit Types:%s   Stop: %d | Target: %d | Trail: %d | MaxHold: %d\n",
-            clr::CYAN, clr::RESET, stops, targets, trails, max_holds);
+    TradingEngine engine(params, spec);
+    OrderParams op;
+    op.queue_ahead = h.queue_ahead;
+    op.slippage = h.slippage;
+    op.levels = h.levels;
+    op.capacity = h.capacity;
+    OrderManager orders(op);
+    if (h.flags & journal::ORDERS) engine.set_orders(&orders);
+    ConfigChannel configs;
+    configs.publish(std::make_unique<LiveConfig>(LiveConfig{params, 0}));
+    engine.set_config(&configs);
 
-        std::printf("\n  %s══════════════════════════════════════════════════════════════════%s\n", clr::BOLD, clr::RESET);
+    journal::Writer check;
+    check.expect(in.pos(), (size_t)(scan.pos() - in.pos()), 1);
+    auto t0 = std::chrono::steady_clock::now();
+    RunStats s = engine.replay_journal(in, h.flags & journal::TICK_MODE, configs, check);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
 
-        // Verdict
-        if (net > 0 && pf > 1.2 && win_rate > 45) {
-            std::printf("  %s%s  STRATEGIE VIABLE — Pret pour Phase 2 (IB Gateway + CME)%s\n",
-                clr::BOLD, clr::GREEN, clr::RESET);
-        } else if (net > 0) {
-            std::printf("  %s%s  STRATEGIE OK — Optimisation des parametres recommandee%s\n",
-                clr::BOLD, clr::YELLOW, clr::RESET);
-        } else {
-            std::printf("  %s%s  STRATEGIE A REVOIR — Ajuster les indicateurs/risk%s\n",
-                clr::BOLD, clr::RED, clr::RESET);
-        }
-        std::printf("\n");
+    std::printf("\n  %sJournal:%s %s  %s%s%s, %llu records (%.1f MB)%s\n", clr::CYAN, clr::RESET, path,
+        symbol.c_str(), h.flags & journal::TICK_MODE ? " ticks" : " bars", h.flags & journal::ORDERS ? " + orders" : "",
+        (unsigned long long)records, data.size() / 1e6, torn ? ", torn tail ignored" : "");
+    std::printf("  %sReplay:%s %.1f ms (%.1fM records/sec) | %d trades | net $%.2f\n", clr::CYAN, clr::RESET,
+        ms, check.records() / (ms * 1000.0), s.trades, s.net);
+    bool ok = check.complete();
+    if (ok) {
+        std::printf("  %sVerify:%s %sMATCH%s (all %llu records identical)\n\n", clr::CYAN, clr::RESET,
+            clr::GREEN, clr::RESET, (unsigned long long)records);
+    } else if (check.diverged()) {
+        std::printf("  %sVerify:%s %sDIVERGED%s\n    journal: %s\n    replay:  %s\n\n", clr::CYAN, clr::RESET,
+            clr::RED, clr::RESET, check.expected().c_str(), check.actual().c_str());
+    } else {
+        std::printf("  %sVerify:%s %sDIVERGED%s (replay stopped short)\n    journal: %s\n\n", clr::CYAN, clr::RESET,
+            clr::RED, clr::RESET, check.pending().c_str());
     }
-};
+    return ok;
+}
 
 // ── Main ────────────────────────────────────────────────────────────────────
+// bench.cpp includes this file with QUADSCALP_NO_MAIN defined
+#ifndef QUADSCALP_NO_MAIN
 int main(int argc, char* argv[]) {
     int num_bars = 1000;
     bool slow = false;
+    bool sweep = false;
+    bool portfolio = false;
+    std::vector<const ContractSpec*> instruments;
+    double portfolio_loss = -1500;
+    bool ticks = false;
+    bool book_mode = false;
+    bool alloc_check = false;
+    int bank_lanes = 0;
+    bool bank_float = false;
+    unsigned threads = std::thread::hardware_concurrency();
+    size_t top = 20;
+    std::string rank = "net";
+    ParamGrid grid;
+    const char* record_path = nullptr;
+    const char* data_path = nullptr;
+    const char* stream_path = nullptr;
+    const char* shm_name = nullptr;
+    bool headless = false;
+    MonteCarloOptions mc;
+    mc.paths = 0;
+    SeedSweepOptions seed_sweep;
+    seed_sweep.seeds = 0;
+    const char* config_path = nullptr;
+    const char* snapshot_path = nullptr;
+    const char* restore_path = nullptr;
+    int snapshot_every = 720;    // 1h of 5s bars
+    double from_sec = -1, to_sec = -1;
+    const char* import_in = nullptr;
+    const char* import_out = nullptr;
+    CsvImporter::Options import_opt;
+    bool use_orders = false;
+    OrderParams order_params;
+    const char* journal_path = nullptr;
+    const char* verify_path = nullptr;
+    bool pipelined = false;
+    PipelineOptions pipe;
+    if (std::vector<int> cpus = allowed_cpus(); cpus.size() >= 4)   // leave the first allowed CPU to the OS
+        for (int k = 0; k < 3; ++k) pipe.cpus[k] = cpus[k + 1];
 
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
         if (arg == "--slow") slow = true;
         if (arg == "--bars" && i + 1 < argc) num_bars = std::stoi(argv[++i]);
+        if (arg == "--sweep") sweep = true;
+        if (arg == "--ticks") ticks = true;
+        if (arg == "--book") book_mode = ticks = true;
+        if (arg == "--orders") use_orders = ticks = true;
+        if (arg == "--slippage" && i + 1 < argc) order_params.slippage = std::stoi(argv[++i]);
+        if (arg == "--queue" && i + 1 < argc) order_params.queue_ahead = std::stod(argv[++i]);
+        if (arg == "--alloc-check") alloc_check = true;
+        if (arg == "--bank" && i + 1 < argc) bank_lanes = std::stoi(argv[++i]);
+        if (arg == "--float") bank_float = true;
+        if (arg == "--threads" && i + 1 < argc) threads = (unsigned)std::stoi(argv[++i]);
+        if (arg == "--top" && i + 1 < argc) top = (size_t)std::stoul(argv[++i]);
+        if (arg == "--rank" && i + 1 < argc) rank = argv[++i];
+        if (arg == "--record" && i + 1 < argc) record_path = argv[++i];
+        if (arg == "--data" && i + 1 < argc) data_path = argv[++i];
+        if (arg == "--stream" && i + 1 < argc) stream_path = argv[++i];
+        if (arg == "--headless") headless = true;
+        if (arg == "--shm" && i + 1 < argc) shm_name = argv[++i];
+        if (arg == "--mc" && i + 1 < argc) mc.paths = (size_t)std::stoul(argv[++i]);
+        if (arg == "--block" && i + 1 < argc) mc.block = (size_t)std::stoul(argv[++i]);
+        if (arg == "--config" && i + 1 < argc) config_path = argv[++i];
+        if (arg == "--snapshot" && i + 1 < argc) snapshot_path = argv[++i];
+        if (arg == "--snapshot-every" && i + 1 < argc) snapshot_every = std::stoi(argv[++i]);
+        if (arg == "--restore" && i + 1 < argc) restore_path = argv[++i];
+        if (arg == "--journal" && i + 1 < argc) journal_path = argv[++i];
+        if (arg == "--verify" && i + 1 < argc) verify_path = argv[++i];
+        if (arg == "--pipeline") pipelined = true;
+        if (arg == "--cpus" && i + 1 < argc) {
+            pipelined = true;
+            if (std::sscanf(argv[++i], "%d,%d,%d", &pipe.cpus[0], &pipe.cpus[1], &pipe.cpus[2]) != 3) {
+                std::fprintf(stderr, "Invalid --cpus list (want FEED,STRATEGY,EXEC): %s\n", argv[i]);
+                return 1;
+            }
+        }
+        if (arg == "--seeds" && i + 1 < argc) seed_sweep.seeds = std::stoi(argv[++i]);
+        if (arg == "--seed" && i + 1 < argc) seed_sweep.first_seed = (uint32_t)std::stoul(argv[++i]);
+        if ((arg == "--vol" || arg == "--mean-rev") && i + 1 < argc) {
+            auto& list = arg == "--vol" ? seed_sweep.vols : seed_sweep.mean_revs;
+            if (!parse_values(argv[++i], list)) {
+                std::fprintf(stderr, "Invalid %s list: %s\n", arg.c_str(), argv[i]);
+                return 1;
+            }
+        }
+        if (arg == "--from" && i + 1 < argc) from_sec = std::stod(argv[++i]);
+        if (arg == "--to" && i + 1 < argc) to_sec = std::stod(argv[++i]);
+        if (arg == "--import" && i + 2 < argc) { import_in = argv[++i]; import_out = argv[++i]; }
+        if (arg == "--symbol" && i + 1 < argc) import_opt.symbol = argv[++i];
+        if (arg == "--tick" && i + 1 < argc) import_opt.tick_size = std::stod(argv[++i]);
+        if (arg == "--interval" && i + 1 < argc) import_opt.interval_ns = (int64_t)(std::stod(argv[++i]) * 1e9);
+        if (arg == "--delim" && i + 1 < argc) import_opt.delim = argv[++i][0];
+        if (arg == "--portfolio") portfolio = true;
+        if (arg == "--max-loss" && i + 1 < argc) portfolio_loss = -std::abs(std::stod(argv[++i]));
+        if (arg == "--instruments" && i + 1 < argc) {
+            portfolio = true;
+            std::string list = argv[++i];
+            for (size_t b = 0; b <= list.size();) {
+                size_t e = std::min(list.find(',', b), list.size());
+                const ContractSpec* c = find_contract(list.substr(b, e - b));
+                if (!c) {
+                    std::fprintf(stderr, "Unknown instrument: %s\n", list.substr(b, e - b).c_str());
+                    return 1;
+                }
+                instruments.push_back(c);
+                b = e + 1;
+            }
+        }
+        if (arg == "--grid" && i + 1 < argc) {
+            if (!grid.add(argv[++i])) {
+                std::fprintf(stderr, "Invalid --grid spec: %s\n", argv[i]);
+                return 1;
+            }
+            sweep = true;
+        }
+    }
+
+    if (alloc_check) return run_alloc_check(num_bars) ? 0 : 1;
+    if (verify_path) return run_journal_verify(verify_path) ? 0 : 1;
+
+    if (seed_sweep.seeds > 0) {
+        seed_sweep.threads = threads;
+        run_seed_sweep(instruments.empty() ? CONTRACTS[0] : *instruments[0], num_bars, seed_sweep);
+        return 0;
+    }
+
+    if (portfolio) {
+        if (instruments.empty())
+            for (const auto& c : CONTRACTS) instruments.push_back(&c);
+        run_portfolio(instruments, num_bars, threads, portfolio_loss);
+        return 0;
+    }
+
+    if (bank_lanes > 0) {
+        if (bank_float) run_bank_check<float>(bank_lanes, num_bars);
+        else            run_bank_check<double>(bank_lanes, num_bars);
+        return 0;
+    }
+
+    if (import_in) {
+        if (import_opt.interval_ns <= 0 || import_opt.tick_size <= 0) {
+            std::fprintf(stderr, "--interval and --tick must be positive\n");
+            return 1;
+        }
+        import_opt.threads = threads;
+        CsvImporter importer(import_opt);
+        return importer.run(import_in, import_out) ? 0 : 1;
+    }
+
+    if (record_path) {
+        std::vector<Bar> bars = simulate_bars(num_bars);
+        BarStoreWriter out;
+        if (!out.open(record_path, "ES", MarketSimulator::BAR_NS, 0.25)
+            || !out.append(bars.data(), bars.size()) || !out.close()) {
+            std::fprintf(stderr, "Cannot write bar store: %s\n", record_path);
+            return 1;
+        }
+        std::printf("  %sRecorded:%s %zu bars -> %s\n", clr::CYAN, clr::RESET, bars.size(), record_path);
+        return 0;
+    }
+
+    // Bar series: mapped store (optionally windowed by time) or simulator
+    BarStore store;
+    size_t data_from = 0, data_to = 0;
+    ContractSpec spec = CONTRACTS[0];
+    if (data_path) {
+        if (!store.open(data_path)) {
+            std::fprintf(stderr, "Cannot open bar store: %s\n", store.error().c_str());
+            return 1;
+        }
+        // Store prices are ticks of the store's tick size; dollars follow the
+        // symbol's point value (ES if unknown)
+        if (const ContractSpec* c = find_contract(store.symbol())) spec = *c;
+        spec.tick_size = store.tick_size();
+        spec.tick_value = spec.point_value * spec.tick_size;
+        data_from = from_sec >= 0 ? store.seek((int64_t)(from_sec * 1e9)) : 0;
+        data_to   = to_sec >= 0 ? store.seek((int64_t)(to_sec * 1e9)) : store.size();
+        data_to   = std::max(data_from, data_to);
+    }
+
+    if (sweep) {
+        if (grid.empty()) {
+            // Default grid: 3^5 = 243 combinations around the production config
+            grid.add("rsi=10,14,21");
+            grid.add("min_score=0.4,0.5,0.6");
+            grid.add("stop=1.0,1.5,2.0");
+            grid.add("target=2.0,3.0,4.0");
+            grid.add("trail=0.3,0.5,0.7");
+        }
+        if (data_path) {
+            run_sweep(grid, store.begin() + data_from, data_to - data_from, threads, top, rank, spec);
+        } else {
+            std::vector<Bar> bars = simulate_bars(num_bars);
+            run_sweep(grid, bars.data(), bars.size(), threads, top, rank);
+        }
+        return 0;
+    }
+
+    ConfigChannel config;
+    ConfigWatcher config_watcher(config);
+    StrategyParams config_params;
+    if (config_path) {
+        std::string err;
+        if (!config_watcher.load(config_path, config_params, err)) {
+            std::fprintf(stderr, "Invalid config: %s\n", err.c_str());
+            return 1;
+        }
     }
 
     auto t0 = std::chrono::high_resolution_clock::now();
 
-    TradingEngine engine;
-    engine.run(num_bars, slow);
+    // Console run: the compiled production strategy, or the parameter-driven
+    // engine when a --config file may change it live
+    auto console = [&](auto& engine) -> int {
+        if (pipelined && (data_path || restore_path || snapshot_path)) {
+            std::fprintf(stderr, "--pipeline runs the simulator from bar 1 (not with --data/--restore/--snapshot)\n");
+            return 1;
+        }
+        if (book_mode && data_path) {
+            std::fprintf(stderr, "--book runs its own order book simulation (not with --data)\n");
+            return 1;
+        }
+        if (ticks && data_path) {
+            std::fprintf(stderr, "--ticks/--orders run the simulator tick by tick (not with --data)\n");
+            return 1;
+        }
+        if ((restore_path || snapshot_path) && ticks) {
+            std::fprintf(stderr, "--snapshot/--restore need a bar-driven run (not --ticks/--book/--orders)\n");
+            return 1;
+        }
+        auto source = data_path ? snapshot::BAR_STORE : snapshot::SIMULATOR;
+        if (restore_path) {
+            auto r0 = std::chrono::steady_clock::now();
+            std::string err;
+            if (!engine.restore_snapshot(restore_path, source, err)) {
+                std::fprintf(stderr, "Cannot restore %s: %s\n", restore_path, err.c_str());
+                return 1;
+            }
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - r0).count();
+            std::printf("\n  %sSnapshot:%s restored bar %d from %s in %.0f us\n", clr::CYAN, clr::RESET,
+                engine.resume_bar(), restore_path, us);
+        }
+        if (snapshot_path) engine.set_snapshot(snapshot_path, snapshot_every, source);
+        BookSimulator book;
+        NdjsonStream stream;
+        ShmFeed feed;
+        if (shm_name) {
+            if (!feed.open(shm_name, data_path ? store.symbol() : "ES")) {
+                std::fprintf(stderr, "Cannot create shared-memory feed: %s\n", feed.error().c_str());
+                return 1;
+            }
+            engine.set_feed(&feed);
+        }
+        ConsoleLog log;
+        if (!headless) {
+            log.start();
+            engine.set_log(&log);
+        }
+        if (stream_path) {
+            if (!stream.open(stream_path)) {
+                std::fprintf(stderr, "Cannot write stream: %s (%s)\n", stream_path, std::strerror(errno));
+                return 1;
+            }
+            engine.set_stream(&stream);
+        }
+        OrderManager orders(order_params);
+        if (use_orders) engine.set_orders(&orders);
+        journal::Writer journal;
+        if (journal_path) {
+            if (restore_path) {
+                std::fprintf(stderr, "--journal records a run from its first bar (not with --restore)\n");
+                return 1;
+            }
+            journal::Header h{};
+            std::memcpy(h.magic, journal::MAGIC, sizeof(h.magic));
+            h.version = journal::VERSION;
+            if (ticks)      h.flags |= journal::TICK_MODE;
+            if (use_orders) h.flags |= journal::ORDERS;
+            std::snprintf(h.symbol, sizeof(h.symbol), "%s", data_path ? store.symbol() : spec.symbol);
+            h.tick_size = spec.tick_size;
+            h.tick_value = spec.tick_value;
+            h.commission = spec.commission;
+            h.queue_ahead = order_params.queue_ahead;
+            h.slippage = order_params.slippage;
+            h.levels = order_params.levels;
+            h.capacity = order_params.capacity;
+            if (!journal.open(journal_path, h, config_path ? config_params : ProductionStrategy::PARAMS)) {
+                std::fprintf(stderr, "Cannot write journal: %s\n", journal.error().c_str());
+                return 1;
+            }
+            engine.set_journal(&journal);
+        }
+        if (data_path) {
+            BarReplay src(store, data_from, data_to);
+            num_bars = (int)std::max<size_t>(src.remaining(), 1) - 1;
+            std::string label = std::string(store.symbol()) + " (replay)";
+            engine.replay(src, label.c_str(), slow);
+        } else if (pipelined && book_mode) {
+            engine.run_pipelined(book, "ES (order book, ticks, pipelined)", num_bars, true, slow, pipe);
+        } else if (pipelined) {
+            engine.run_pipelined(num_bars, ticks, slow, pipe);
+        } else if (book_mode) {
+            engine.run_ticks(book, "ES (order book, ticks)", num_bars, slow);
+        } else if (ticks) {
+            engine.run_ticks(num_bars, slow);
+        } else {
+            engine.run(num_bars, slow);
+        }
+
+        auto t1 = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
 
-    auto t1 = std::chrono::high_resolution_clock::now();
-    double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        std::printf("  %sExecution:%s %.1f ms (%d bars, %.0f bars/sec)\n\n",
+            clr::DIM, clr::RESET, ms, num_bars, num_bars / (ms / 1000.0));
+        if (ticks) {
+            double n_ticks = (double)engine.ticks_seen();
+            std::printf("  %sTicks:%s %.0f (%.1fM ticks/sec)\n\n", clr::DIM, clr::RESET,
+                n_ticks, n_ticks / (ms * 1000.0));
+        }
+        if (book_mode) {
+            std::printf("  %sBook:%s %llu events, %llu trades (%.1fM events/sec)\n\n", clr::DIM, clr::RESET,
+                (unsigned long long)book.events(), (unsigned long long)book.trades(),
+                book.events() / (ms * 1000.0));
+            BookDepth d;
+            book.depth(d);
+            std::printf("  %s%10s %10s | %-10s %s%s\n", clr::DIM, "Bid size", "Bid", "Ask", "Ask size", clr::RESET);
+            for (int k = 0; k < BookDepth::LEVELS; ++k) {
+                if (k < d.n_bids) std::printf("  %s%10d %10.2f%s", clr::GREEN, d.bids[k].size, d.bids[k].price, clr::RESET);
+                else              std::printf("  %21s", "");
+                if (k < d.n_asks) std::printf(" | %s%-10.2f %d%s\n", clr::RED, d.asks[k].price, d.asks[k].size, clr::RESET);
+                else              std::printf(" |\n");
+            }
+            std::printf("\n");
+        }
+        if (pipelined) {
+            static const char* const STAGES[3] = {"feed", "strategy", "exec"};
+            std::printf("  %sPipeline:%s", clr::DIM, clr::RESET);
+            for (int k = 0; k < 3; ++k) {
+                if (pipe.cpus[k] < 0)       std::printf(" %s unpinned%s", STAGES[k], k < 2 ? " |" : "");
+                else if (pipe.pinned[k])    std::printf(" %s cpu %d%s", STAGES[k], pipe.cpus[k], k < 2 ? " |" : "");
+                else                        std::printf(" %s cpu %d (pin failed)%s", STAGES[k], pipe.cpus[k], k < 2 ? " |" : "");
+            }
+            std::printf("\n\n");
+        }
+        if (journal_path) {
+            uint64_t n = journal.records(), bytes = journal.bytes();
+            if (!journal.close()) {
+                std::fprintf(stderr, "Cannot write journal: %s\n", journal_path);
+                return 1;
+            }
+            std::printf("  %sJournal:%s %llu records (%.1f MB) -> %s\n\n", clr::DIM, clr::RESET,
+                (unsigned long long)n, bytes / 1e6, journal_path);
+        }
+        if (use_orders) {
+            std::printf("  %sOrders:%s %llu submitted, %llu fills, %llu cancelled (queue %.0f, slippage %d ticks)\n\n",
+                clr::DIM, clr::RESET, (unsigned long long)orders.submitted(), (unsigned long long)orders.fills(),
+                (unsigned long long)orders.cancels(), order_params.queue_ahead, order_params.slippage);
+        }
 
-    std::printf("  %sExecution:%s %.1f ms (%d bars, %.0f bars/sec)\n\n",
-        clr::DIM, clr::RESET, ms, num_bars, num_bars / (ms / 1000.0));
+        if (mc.paths > 0) {
+            mc.threads = std::max(1u, threads);
+            mc.ruin = engine.risk().max_daily_loss();
+            print_monte_carlo(run_monte_carlo(engine.trades(), mc), mc.ruin, mc.threads);
+        }
+
+        return 0;
+    };
 
-    return 0;
+    if (config_path) {
+        TradingEngine engine(config_params, spec);
+        engine.set_config(&config);
+        config_watcher.start();
+        return console(engine);
+    }
+    BasicTradingEngine<ProductionStrategy> engine(ProductionStrategy::PARAMS, spec);
+    return console(engine);
 }
+#endif // QUADSCALP_NO_MAIN
@@ -0,0 +1,101 @@
+// ============================================================================
+// QuadScalp Feed Reader — C ABI over the /dev/shm engine feed (qs_feed.h)
+// Build: g++ -O2 -std=c++20 -shared -fPIC -o libqsfeed.so qs_feed.cpp
+// ============================================================================
+#include "qs_feed.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct qs_feed {
+    void*                 map = MAP_FAILED;
+    size_t                len = 0;
+    const qs_feed_header* hdr = nullptr;
+    const qs_feed_record* slots = nullptr;
+    uint64_t              generation = 0;
+    uint64_t              next = 0;      // next record number to read
+    uint64_t              dropped = 0;
+};
+
+extern "C" {
+
+qs_feed* qs_feed_open(const char* name) {
+    std::string path = std::string("/") + name;
+    int fd = shm_open(path.c_str(), O_RDONLY, 0);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    size_t want = QS_FEED_DATA + (size_t)QS_FEED_SLOTS * sizeof(qs_feed_record);
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < want) { ::close(fd); return nullptr; }
+    void* map = mmap(nullptr, want, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return nullptr;
+
+    auto* hdr = static_cast<const qs_feed_header*>(map);
+    if (hdr->magic != QS_FEED_MAGIC || hdr->version != QS_FEED_VERSION ||
+        hdr->record_size != sizeof(qs_feed_record) || hdr->slots != QS_FEED_SLOTS) {
+        munmap(map, want);
+        return nullptr;
+    }
+
+    auto* f = new qs_feed;
+    f->map = map;
+    f->len = want;
+    f->hdr = hdr;
+    f->slots = reinterpret_cast<const qs_feed_record*>(static_cast<const char*>(map) + QS_FEED_DATA);
+    f->generation = __atomic_load_n(&hdr->generation, __ATOMIC_ACQUIRE);
+    f->next = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+    return f;
+}
+
+void qs_feed_close(qs_feed* f) {
+    if (!f) return;
+    if (f->map != MAP_FAILED) munmap(f->map, f->len);
+    delete f;
+}
+
+int qs_feed_read(qs_feed* f, qs_feed_record* out, int max) {
+    if (!f || max <= 0) return 0;
+    if (__atomic_load_n(&f->hdr->magic, __ATOMIC_ACQUIRE) != QS_FEED_MAGIC) return 0;   // being reset
+    uint64_t gen = __atomic_load_n(&f->hdr->generation, __ATOMIC_ACQUIRE);
+    if (gen != f->generation) {                          // writer restarted: follow from record 0
+        f->generation = gen;
+        f->next = 0;
+    }
+    uint64_t head = __atomic_load_n(&f->hdr->head, __ATOMIC_ACQUIRE);
+    if (head < f->next) f->next = head;
+    if (head - f->next > QS_FEED_SLOTS) {                // lapped: skip to oldest live slot
+        f->dropped += head - f->next - QS_FEED_SLOTS;
+        f->next = head - QS_FEED_SLOTS;
+    }
+
+    int n = 0;
+    while (n < max && f->next < head) {
+        const qs_feed_record* s = &f->slots[f->next & (QS_FEED_SLOTS - 1)];
+        uint64_t want = f->next + 1;
+        uint64_t s1 = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+        if (s1 == want) {
+            std::memcpy(&out[n], s, sizeof(qs_feed_record));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) == want) { ++n; ++f->next; continue; }
+        }
+        // Overwritten while we were behind (or being rewritten right now)
+        ++f->dropped;
+        ++f->next;
+    }
+    return n;
+}
+
+uint64_t qs_feed_head(const qs_feed* f) {
+    return f ? __atomic_load_n(&f->hdr->head, __ATOMIC_ACQUIRE) : 0;
+}
+
+uint64_t qs_feed_dropped(const qs_feed* f) { return f ? f->dropped : 0; }
+
+const char* qs_feed_symbol(const qs_feed* f) { return f ? f->hdr->symbol : ""; }
+
+} // extern "C"
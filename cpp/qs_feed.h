@@ -0,0 +1,78 @@
+/* ============================================================================
+ * QuadScalp Feed — shared-memory engine feed layout (C ABI)
+ * Written by mini_test --shm NAME into /dev/shm/NAME; read through
+ * libqsfeed.so (qs_feed.cpp) from the Python backend.
+ * Build reader: g++ -O2 -std=c++20 -shared -fPIC -o libqsfeed.so qs_feed.cpp
+ * ============================================================================
+ *
+ * One writer, any number of readers. The writer never waits: slot i holds
+ * record number n where n % slots == i, and is overwritten one lap later.
+ * Publishing n: seq = 0, payload, seq = n + 1 (release), head = n + 1.
+ * A reader copies the slot and re-checks seq; a changed seq means the writer
+ * lapped it and the record is counted as dropped.
+ */
+#ifndef QS_FEED_H
+#define QS_FEED_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define QS_FEED_MAGIC    0x3144454546535351ull   /* "QSSFEED1" little-endian */
+#define QS_FEED_VERSION  1u
+#define QS_FEED_SLOTS    65536u                  /* power of two */
+#define QS_FEED_DATA     4096u                   /* records start one page in */
+
+enum qs_feed_type {
+    QS_TICK     = 1,   /* px: price, size */
+    QS_BAR      = 2,   /* px: open, high, low, close, volume */
+    QS_SIGNAL   = 3,   /* side: +1 buy / -1 sell; code: reason bits; px: score */
+    QS_POSITION = 4,   /* side: +1 long / -1 short / 0 flat; px: entry, stop, target, qty */
+    QS_FILL     = 5    /* side: +1 buy / -1 sell; code: exit reason (0 = entry); px: price, qty, pnl */
+};
+
+typedef struct qs_feed_record {
+    uint64_t seq;      /* record number + 1 once published, 0 while written */
+    int64_t  time;     /* ns (session-relative for simulated data) */
+    int32_t  bar;
+    uint8_t  type;     /* qs_feed_type */
+    int8_t   side;
+    uint16_t code;
+    double   px[5];
+} qs_feed_record;
+
+typedef struct qs_feed_header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t slots;
+    uint64_t writer_pid;
+    uint64_t generation;   /* changes each time a writer (re)creates the feed */
+    char     symbol[16];
+    uint8_t  pad_[8];
+    uint64_t head;     /* records published; __atomic access only */
+} qs_feed_header;
+
+#ifdef __cplusplus
+static_assert(sizeof(qs_feed_record) == 64, "feed record must stay one cache line");
+static_assert(sizeof(qs_feed_header) <= QS_FEED_DATA, "feed header must fit the first page");
+#endif
+
+/* Reader ABI (libqsfeed.so). A reader starts at the current head and follows
+ * a restarted writer from its first record. */
+typedef struct qs_feed qs_feed;
+
+qs_feed*    qs_feed_open(const char* name);          /* NULL if absent or bad magic/version */
+void        qs_feed_close(qs_feed* f);
+int         qs_feed_read(qs_feed* f, qs_feed_record* out, int max);   /* records copied */
+uint64_t    qs_feed_head(const qs_feed* f);
+uint64_t    qs_feed_dropped(const qs_feed* f);       /* records lost to writer laps */
+const char* qs_feed_symbol(const qs_feed* f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QS_FEED_H */